@@ -3,5 +3,7 @@
 
 void enable_hardware_interrupts();
 void disable_hardware_interrupts();
+// 开中断并睡眠到下一次中断（调用前应已关中断）
+void enable_interrupts_and_halt();
 
 #endif /* INCLUDE_HARDWARE_INTERRUPT_ENABLER_H */
\ No newline at end of file
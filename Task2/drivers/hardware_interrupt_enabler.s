@@ -8,4 +8,12 @@ global disable_hardware_interrupts
 
 disable_hardware_interrupts:
     cli
+    ret
+
+global enable_interrupts_and_halt
+
+; sti 之后的一条指令不响应中断，sti 与 hlt 之间到达的中断一定会唤醒 hlt
+enable_interrupts_and_halt:
+    sti
+    hlt
     ret
\ No newline at end of file
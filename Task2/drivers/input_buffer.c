@@ -1,6 +1,7 @@
 #include "input_buffer.h"
 #include "io.h"
 #include "frame_buffer.h"
+#include "hardware_interrupt_enabler.h"
 
 // 循环缓冲区结构
 static struct {
@@ -48,6 +49,17 @@ u32int input_available(void) {
     return input_buffer.count;
 }
 
+// 没有输入时睡眠，直到下一次中断。关中断后再检查缓冲区，
+// 检查之后到达的按键一定会唤醒 hlt
+void input_wait(void) {
+    disable_hardware_interrupts();
+    if (input_buffer.count == 0) {
+        enable_interrupts_and_halt();
+    } else {
+        enable_hardware_interrupts();
+    }
+}
+
 // 读取一行输入
 u32int readline(char* buf, u32int max_len) {
     u32int index = 0;
@@ -64,8 +76,8 @@ u32int readline(char* buf, u32int max_len) {
         c = getc();
         
         if (c == 0) {
-            // 没有可用字符，等待一下
-            // 在实际操作系统中，这里应该让出CPU，但我们现在简单循环
+            // 没有可用字符，睡眠等待下一次键盘中断
+            input_wait();
             continue;
         }
         
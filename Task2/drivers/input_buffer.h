@@ -25,4 +25,7 @@ u32int readline(char* buf, u32int max_len);
 // 检查缓冲区中是否有数据
 u32int input_available(void);
 
+// 缓冲区为空时睡眠，直到下一次中断
+void input_wait(void);
+
 #endif /* INCLUDE_INPUT_BUFFER_H */
\ No newline at end of file
@@ -42,8 +42,10 @@ void test_getc(void) {
         if (c == '\n') {
             break;
         }
-        // 短暂延迟，避免过于频繁的检查
-        for (volatile int i = 0; i < 10000; i++);
+        // 没有字符时睡眠等待下一次键盘中断
+        if (c == 0) {
+            input_wait();
+        }
     }
     
     fb_write_string("\nProcessing buffer contents:\n");
@@ -122,8 +124,8 @@ int kmain()
             }
         }
         
-        // 使用HLT节省CPU
-        __asm__ __volatile__("hlt");
+        // 没有输入时用HLT节省CPU
+        input_wait();
     }
 
     return 0;
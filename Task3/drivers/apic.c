@@ -0,0 +1,237 @@
+#include "apic.h"
+#include "pic.h"
+#include "timer.h"
+#include "klog.h"
+#include "hardware_interrupt_enabler.h"
+#include "interrupts.h"
+
+#define APIC_CPUID_FEATURES   1
+#define APIC_CPUID_EDX_APIC   (1 << 9)
+
+#define APIC_BASE_MSR         0x1B
+#define APIC_BASE_MSR_ENABLE  (1 << 11)
+#define APIC_BASE_ADDRESS     0xFFFFF000
+
+/* Local APIC registers (byte offsets) */
+#define APIC_REG_ID             0x020
+#define APIC_REG_TPR            0x080
+#define APIC_REG_EOI            0x0B0
+#define APIC_REG_SPURIOUS       0x0F0
+#define APIC_REG_LVT_TIMER      0x320
+#define APIC_REG_LVT_LINT0      0x350
+#define APIC_REG_LVT_LINT1      0x360
+#define APIC_REG_LVT_ERROR      0x370
+#define APIC_REG_TIMER_INITIAL  0x380
+#define APIC_REG_TIMER_CURRENT  0x390
+#define APIC_REG_TIMER_DIVIDE   0x3E0
+
+#define APIC_SPURIOUS_ENABLE    0x100
+#define APIC_LVT_MASKED         (1 << 16)
+#define APIC_LVT_TIMER_PERIODIC (1 << 17)
+#define APIC_LVT_NMI            (4 << 8)
+#define APIC_TIMER_DIVIDE_16    0x03
+
+/* I/O APIC registers */
+#define APIC_IO_REGSEL          0x00   // 寄存器选择（字节偏移）
+#define APIC_IO_WINDOW          0x10   // 数据窗口（字节偏移）
+#define APIC_IO_REG_VERSION     0x01
+#define APIC_IO_REG_REDIRECTION(pin) (0x10 + (pin) * 2)
+
+#define APIC_IO_ENTRY_MASKED    (1 << 16)
+
+// ISA IRQ0（PIT）在 I/O APIC 上接到引脚 2（MADT 中的中断源覆盖），其余一一对应
+#define APIC_ISA_TIMER_PIN      2
+
+#define APIC_ISA_IRQS           16
+#define APIC_CALIBRATE_MS       10
+
+static volatile u32int* apic_local = 0;
+static volatile u32int* apic_io = (volatile u32int*) APIC_IO_BASE;
+static u32int apic_io_pins = 0;
+static u8int apic_in_use = 0;
+static u32int apic_timer_hz = 0;
+static u32int apic_timer_count = 0;
+static apic_timer_callback apic_timer_function = 0;
+static void* apic_timer_context = 0;
+
+static void apic_cpuid(u32int leaf, u32int* eax, u32int* ebx, u32int* ecx, u32int* edx) {
+    __asm__ __volatile__("cpuid" : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx) : "0" (leaf));
+}
+
+static void apic_read_msr(u32int msr, u32int* low, u32int* high) {
+    __asm__ __volatile__("rdmsr" : "=a" (*low), "=d" (*high) : "c" (msr));
+}
+
+static void apic_write_msr(u32int msr, u32int low, u32int high) {
+    __asm__ __volatile__("wrmsr" : : "a" (low), "d" (high), "c" (msr));
+}
+
+static u32int apic_read(u32int reg) {
+    return apic_local[reg / 4];
+}
+
+static void apic_write(u32int reg, u32int value) {
+    apic_local[reg / 4] = value;
+}
+
+static u32int apic_io_read(u32int reg) {
+    apic_io[APIC_IO_REGSEL / 4] = reg;
+    return apic_io[APIC_IO_WINDOW / 4];
+}
+
+static void apic_io_write(u32int reg, u32int value) {
+    apic_io[APIC_IO_REGSEL / 4] = reg;
+    apic_io[APIC_IO_WINDOW / 4] = value;
+}
+
+static u32int apic_isa_pin(u32int irq) {
+    return irq == TIMER_IRQ ? APIC_ISA_TIMER_PIN : irq;
+}
+
+// 写一条重定向项：固定投递、物理目标为本 CPU、边沿触发、高电平有效（ISA 的默认方式）。
+// IRQ2 是 8259 的级联线，用 APIC 时不存在；它与 IRQ0 对应同一个引脚，不能写
+static void apic_io_route(u32int irq, u8int masked) {
+    u32int pin = apic_isa_pin(irq);
+    u32int destination = apic_read(APIC_REG_ID) & 0xFF000000;
+
+    if (irq == PIC_CASCADE_IRQ || pin >= apic_io_pins) {
+        return;
+    }
+    apic_io_write(APIC_IO_REG_REDIRECTION(pin) + 1, destination);
+    apic_io_write(APIC_IO_REG_REDIRECTION(pin), (PIC_1_OFFSET + irq) | (masked ? APIC_IO_ENTRY_MASKED : 0));
+}
+
+static void apic_timer_handle_interrupt(struct trap_frame* frame, void* context) {
+    (void)frame;
+    (void)context;
+
+    apic_timer_count++;
+    if (apic_timer_function) {
+        apic_timer_function(apic_timer_context);
+    }
+}
+
+u8int apic_init(void) {
+    u32int eax, ebx, ecx, edx;
+    u32int low, high;
+    u32int version;
+
+    apic_cpuid(APIC_CPUID_FEATURES, &eax, &ebx, &ecx, &edx);
+    if (!(edx & APIC_CPUID_EDX_APIC)) {
+        klog(KLOG_INFO, "No local APIC, using 8259 PIC");
+        return 0;
+    }
+
+    // 没有 I/O APIC 时读到的是全 1
+    version = apic_io_read(APIC_IO_REG_VERSION);
+    if (version == 0xFFFFFFFF) {
+        klog(KLOG_INFO, "No I/O APIC, using 8259 PIC");
+        return 0;
+    }
+    apic_io_pins = ((version >> 16) & 0xFF) + 1;
+
+    // 打开本地 APIC（基地址可能被固件移动过，以 MSR 为准）
+    apic_read_msr(APIC_BASE_MSR, &low, &high);
+    apic_write_msr(APIC_BASE_MSR, low | APIC_BASE_MSR_ENABLE, high);
+    apic_local = (volatile u32int*) ((low & APIC_BASE_ADDRESS) ? (low & APIC_BASE_ADDRESS) : APIC_LOCAL_DEFAULT_BASE);
+
+    // 8259 不再投递中断；LINT0 上的 ExtINT 也屏蔽掉，避免 8259 的伪中断
+    pic_disable();
+    apic_write(APIC_REG_LVT_LINT0, APIC_LVT_MASKED);
+    apic_write(APIC_REG_LVT_LINT1, APIC_LVT_NMI);
+    apic_write(APIC_REG_LVT_ERROR, APIC_LVT_MASKED);
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+    apic_write(APIC_REG_TPR, 0);
+    apic_write(APIC_REG_SPURIOUS, APIC_SPURIOUS_ENABLE | APIC_SPURIOUS_VECTOR);
+
+    // 先屏蔽全部引脚（包括没有 ISA IRQ 接入的引脚 0），由驱动用 irq_unmask 打开
+    for (u32int pin = 0; pin < apic_io_pins; pin++) {
+        apic_io_write(APIC_IO_REG_REDIRECTION(pin), APIC_IO_ENTRY_MASKED);
+    }
+    for (u32int irq = 0; irq < APIC_ISA_IRQS; irq++) {
+        apic_io_route(irq, 1);
+    }
+
+    irq_register(APIC_TIMER_VECTOR, apic_timer_handle_interrupt, 0);
+
+    apic_in_use = 1;
+    klog(KLOG_INFO, "Local APIC and I/O APIC enabled");
+    return 1;
+}
+
+u8int apic_enabled(void) {
+    return apic_in_use;
+}
+
+void apic_acknowledge(void) {
+    apic_write(APIC_REG_EOI, 0);
+}
+
+void apic_unmask(u32int irq) {
+    if (irq < APIC_ISA_IRQS) {
+        apic_io_route(irq, 0);
+    }
+}
+
+void apic_mask(u32int irq) {
+    if (irq < APIC_ISA_IRQS) {
+        apic_io_route(irq, 1);
+    }
+}
+
+void apic_timer_calibrate(void) {
+    u32int elapsed;
+
+    if (!apic_in_use) {
+        return;
+    }
+
+    // 从一个 tick 的边界开始，数 APIC_CALIBRATE_MS 毫秒内定时器减少的计数
+    sleep_ms(1);
+    apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+    apic_write(APIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+    sleep_ms(APIC_CALIBRATE_MS);
+    elapsed = 0xFFFFFFFF - apic_read(APIC_REG_TIMER_CURRENT);
+    apic_write(APIC_REG_TIMER_INITIAL, 0);
+
+    apic_timer_hz = elapsed * (1000 / APIC_CALIBRATE_MS);
+}
+
+u32int apic_timer_frequency(void) {
+    return apic_timer_hz;
+}
+
+void apic_timer_start(u32int count, u8int periodic, apic_timer_callback callback, void* context) {
+    u32int flags;
+
+    if (!apic_in_use || count == 0) {
+        return;
+    }
+    if (periodic && count < apic_timer_hz / APIC_TIMER_MAX_HZ) {
+        count = apic_timer_hz / APIC_TIMER_MAX_HZ;
+    }
+
+    // 先停下定时器再换回调，避免中断处理程序看到一半更新的回调和参数
+    apic_timer_stop();
+    flags = save_and_disable_hardware_interrupts();
+    apic_timer_function = callback;
+    apic_timer_context = context;
+    restore_hardware_interrupts(flags);
+
+    apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+    apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_VECTOR | (periodic ? APIC_LVT_TIMER_PERIODIC : 0));
+    apic_write(APIC_REG_TIMER_INITIAL, count);
+}
+
+void apic_timer_stop(void) {
+    if (!apic_in_use) {
+        return;
+    }
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+    apic_write(APIC_REG_TIMER_INITIAL, 0);
+}
+
+u32int apic_timer_interrupts(void) {
+    return apic_timer_count;
+}
@@ -0,0 +1,51 @@
+#ifndef INCLUDE_APIC_H
+#define INCLUDE_APIC_H
+
+#include "types.h"
+
+#define APIC_LOCAL_DEFAULT_BASE 0xFEE00000  // 本地 APIC 寄存器的默认物理地址
+#define APIC_IO_BASE            0xFEC00000  // I/O APIC 的物理地址（PC/QEMU 的标准位置）
+
+// ISA IRQ 经 I/O APIC 送到与 8259 相同的向量（PIC_1_OFFSET + irq），驱动无需区分
+#define APIC_TIMER_VECTOR    0x30   // 本地 APIC 定时器，紧接 16 个 IRQ 向量之后
+#define APIC_SPURIOUS_VECTOR 0xFF   // 伪中断，不需要 EOI
+
+#define APIC_TIMER_MAX_HZ 10000      // 周期模式的最高中断频率，计数再小就成了中断风暴
+
+// 检测并启用本地 APIC 和 I/O APIC，屏蔽 8259 的全部输出。
+// 返回 1 表示之后的 IRQ 都经 I/O APIC 送达；CPU 没有 APIC 或读不到 I/O APIC 时返回 0，
+// 继续使用 8259
+u8int apic_init(void);
+
+// 是否已经改用 APIC
+u8int apic_enabled(void);
+
+// 向本地 APIC 发送 EOI（一次 MMIO 写）
+void apic_acknowledge(void);
+
+// 打开/屏蔽一条 ISA IRQ（0-15）对应的 I/O APIC 重定向项
+void apic_unmask(u32int irq);
+void apic_mask(u32int irq);
+
+// 本地 APIC 定时器目前只是独立的计时设备（timer lapic 命令用来观察它）：
+// tick 计数、sleep_ms 和内核定时器仍然只由 PIT 驱动
+
+// 用 PIT 测量本地 APIC 定时器的频率（需要在时钟和中断都已打开后调用）
+void apic_timer_calibrate(void);
+
+// 本地 APIC 定时器的计数频率（Hz），未测量时为 0
+u32int apic_timer_frequency(void);
+
+// 定时器到期时在中断处理程序中调用（EOI 由分发程序发送）
+typedef void (*apic_timer_callback)(void* context);
+
+// 启动定时器：计数 count 次后在 APIC_TIMER_VECTOR 上产生中断并调用 callback，
+// periodic 不为 0 时周期重复，频率不超过 APIC_TIMER_MAX_HZ（count 太小时按上限处理）。
+// callback 可以为 0（只计数）
+void apic_timer_start(u32int count, u8int periodic, apic_timer_callback callback, void* context);
+void apic_timer_stop(void);
+
+// 本地 APIC 定时器中断次数
+u32int apic_timer_interrupts(void);
+
+#endif /* INCLUDE_APIC_H */
@@ -1,112 +1,596 @@
-#include "io.h"
-#include "frame_buffer.h"
-
-#define FB_COMMAND_PORT         0x3D4
-#define FB_DATA_PORT            0x3D5
-
-#define FB_HIGH_BYTE_COMMAND    14
-#define FB_LOW_BYTE_COMMAND     15
-
-/* Frame buffer */
-char *fb = (char *) 0x000B8000;
-
-/* Current cursor position - 全局变量 */
-u16int cursor_pos = 0;
-
-void fb_move_cursor(u16int pos) {
-    outb(FB_COMMAND_PORT, FB_HIGH_BYTE_COMMAND);
-    outb(FB_DATA_PORT,    ((pos >> 8) & 0x00FF));
-    outb(FB_COMMAND_PORT, FB_LOW_BYTE_COMMAND);
-    outb(FB_DATA_PORT,    pos & 0x00FF);
-    cursor_pos = pos;
-}
-
-void fb_write_cell(unsigned int i, char c, unsigned char fg, unsigned char bg) {
-    fb[i * 2] = c;
-    fb[i * 2 + 1] = ((fg & 0x0F) << 4) | (bg & 0x0F);
-}
-
-void fb_write_char(char c) {
-    // 处理换行符
-    if (c == '\n') {
-        fb_newline();
-        return;
-    }
-    
-    // 处理回车符
-    if (c == '\r') {
-        unsigned int current_row = cursor_pos / 80;
-        cursor_pos = current_row * 80;
-        fb_move_cursor(cursor_pos);
-        return;
-    }
-    
-    // 正常字符
-    fb_write_cell(cursor_pos, c, FB_WHITE, FB_BLACK);
-    cursor_pos++;
-    
-    // 检查是否需要换行（到达行尾）
-    if (cursor_pos >= 80 * 25) {
-        // 改为滚动而不是清屏
-        fb_newline();  // 这会处理滚动
-    } else {
-        fb_move_cursor(cursor_pos);
-    }
-}
-
-void fb_write_string(const char* str) {
-    while (*str) {
-        fb_write_char(*str);
-        str++;
-    }
-}
-
-void fb_backspace(void) {
-    if (cursor_pos > 0) {
-        cursor_pos--;
-        // 用空格覆盖上一个字符
-        fb_write_cell(cursor_pos, ' ', FB_WHITE, FB_BLACK);
-        fb_move_cursor(cursor_pos);
-    }
-}
-
-void fb_newline(void) {
-    // 计算当前行，每行80个字符
-    unsigned int current_row = cursor_pos / 80;
-    // 移动到下一行开头
-    cursor_pos = (current_row + 1) * 80;
-    
-    // 如果超出屏幕底部，需要滚动屏幕
-    if (cursor_pos >= 80 * 25) {
-        // 简单的滚动：将所有行上移一行
-        for (int i = 0; i < 80 * 24; i++) {
-            // 将下一行的内容复制到当前行
-            fb[i * 2] = fb[(i + 80) * 2];           // 字符
-            fb[i * 2 + 1] = fb[(i + 80) * 2 + 1];   // 颜色属性
-        }
-        
-        // 清空最后一行
-        for (int i = 80 * 24; i < 80 * 25; i++) {
-            fb_write_cell(i, ' ', FB_WHITE, FB_BLACK);
-        }
-        
-        // 光标移动到最后一行的开头
-        cursor_pos = 80 * 24;
-    }
-    
-    fb_move_cursor(cursor_pos);
-}
-
-void fb_clear(void) {
-    for (int i = 0; i < 80 * 25; i++) {
-        fb_write_cell(i, ' ', FB_WHITE, FB_BLACK);
-    }
-    cursor_pos = 0;
-    fb_move_cursor(cursor_pos);
-}
-
-void fb_write_hex(u8int value) {
-    char hex_chars[] = "0123456789ABCDEF";
-    fb_write_char(hex_chars[(value >> 4) & 0x0F]);
-    fb_write_char(hex_chars[value & 0x0F]);
-}
\ No newline at end of file
+#include "io.h"
+#include "frame_buffer.h"
+#include "serial.h"
+
+#define FB_COMMAND_PORT         0x3D4
+#define FB_DATA_PORT            0x3D5
+
+#define FB_START_HIGH_COMMAND   12
+#define FB_START_LOW_COMMAND    13
+#define FB_HIGH_BYTE_COMMAND    14
+#define FB_LOW_BYTE_COMMAND     15
+
+// 文本模式显存共 32 KB（0xB8000 - 0xBFFFF），可容纳的整行数
+#define FB_VRAM_ROWS            (0x8000 / (FB_COLS * 2))
+
+// 每个虚拟控制台独占一段显存页，硬件滚动的窗口只在自己的页内移动
+#define FB_CONSOLE_VRAM_ROWS    (FB_VRAM_ROWS / FB_CONSOLE_COUNT)
+
+/* Frame buffer */
+char *fb = (char *) 0x000B8000;
+
+#define FB_ALL_ROWS_DIRTY ((1u << FB_ROWS) - 1)
+
+// 虚拟控制台：每个都有自己的影子缓冲区、光标、显存窗口和回滚历史
+struct fb_console {
+    // 显存的内存影子：所有写入先落在这里，再由 fb_flush 按行批量拷贝到显存。
+    // 影子按行组成环，top 是屏幕第 0 行所在的影子行，滚动时只需移动它
+    u16int shadow[FB_CELLS];
+    u32int top;
+
+    // 脏行位图：第 n 位为 1 表示屏幕第 n 行与显存不一致
+    u32int dirty_rows;
+
+    // 当前光标位置（屏幕内的单元下标）
+    u16int cursor;
+
+    // 本控制台显存页的首行，以及屏幕窗口在页内的起始行
+    u32int vram_base;
+    u32int origin;
+
+    // 回滚历史：滚出屏幕顶部的行按显存单元格式追加到这个环里
+    u16int history[FB_HISTORY_LINES][FB_COLS];
+    u32int history_next;   // 下一次追加的位置
+    u32int history_count;  // 环中有效行数
+
+    // 当前向上回看的行数，0 表示显示实时屏幕
+    u32int view_offset;
+
+    // 显存窗口被回看内容覆盖过，回到实时屏幕时需要整屏重画。
+    // 与脏行分开：脏行只表示控制台自己有新输出
+    u8int needs_redraw;
+
+    u8int ready;
+};
+
+static struct fb_console fb_consoles[FB_CONSOLE_COUNT];
+
+// fb_con 是输出目标，fb_shown 是正在显示的控制台；
+// 两者不同时输出只写内存，切换回来时再按脏行刷新
+static struct fb_console *fb_con = &fb_consoles[0];
+static struct fb_console *fb_shown = &fb_consoles[0];
+
+// 硬件滚动：通过 CRTC 起始地址寄存器在显存中平移窗口
+static u8int fb_hw_scroll = 1;
+
+// 硬件当前的起始地址与光标位置（以单元为单位）；0xFFFF 表示未知
+static u16int fb_hw_origin = 0xFFFF;
+static u16int fb_hw_cursor = 0xFFFF;
+
+// 延迟刷新：打开后写操作只改影子缓冲区，由空闲循环或显式 fb_flush 刷新显存
+static u8int fb_deferred = 0;
+
+// 光标统计：有尚未写入硬件的光标移动；因移动被合并或被抵消而省下的端口写入次数
+static u8int fb_cursor_pending = 0;
+static u32int fb_cursor_writes_skipped = 0;
+
+static void fb_put_char(char c);
+static void fb_put_newline(void);
+
+// 用 rep movsl 以 32 位宽度拷贝一整行（80 个单元 = 40 个双字）
+static void fb_copy_row(void *dst, const void *src) {
+    u32int d0, d1, d2;
+    __asm__ __volatile__("cld; rep movsl"
+                         : "=&D" (d0), "=&S" (d1), "=&c" (d2)
+                         : "0" (dst), "1" (src), "2" (FB_COLS / 2)
+                         : "memory");
+}
+
+// 屏幕第 row 行在影子缓冲区中的地址
+static u16int *fb_shadow_row(u32int row) {
+    return &fb_con->shadow[((fb_con->top + row) % FB_ROWS) * FB_COLS];
+}
+
+static void fb_fill_blank(u16int *cells) {
+    u16int blank = (u16int) (' ' | (((FB_WHITE & 0x0F) << 4 | (FB_BLACK & 0x0F)) << 8));
+
+    for (u32int i = 0; i < FB_COLS; i++) {
+        cells[i] = blank;
+    }
+}
+
+// 屏幕第 row 行在显存中的地址
+static char *fb_vram_row(u32int row) {
+    return fb + (fb_con->vram_base + fb_con->origin + row) * FB_COLS * 2;
+}
+
+static void fb_clear_row(u32int row) {
+    fb_fill_blank(fb_shadow_row(row));
+    fb_con->dirty_rows |= 1u << row;
+}
+
+// 向历史环追加一行，返回该行的存储位置（O(1)）
+static u16int *fb_history_append(void) {
+    u16int *line = fb_con->history[fb_con->history_next];
+
+    fb_con->history_next = (fb_con->history_next + 1) % FB_HISTORY_LINES;
+    if (fb_con->history_count < FB_HISTORY_LINES) {
+        fb_con->history_count++;
+    }
+    return line;
+}
+
+// 只更新软件光标，真正的 CRTC 写入推迟到 fb_flush
+void fb_move_cursor(u16int pos) {
+    fb_con->cursor = pos;
+
+    // 上一次移动还没写到硬件就被这一次取代，省下它的 4 次端口写入
+    if (fb_cursor_pending) {
+        fb_cursor_writes_skipped += 4;
+    }
+    fb_cursor_pending = 1;
+}
+
+// 软件光标与硬件光标不一致时才写 4 次端口
+static void fb_sync_cursor(void) {
+    u16int pos = (u16int) ((fb_con->vram_base + fb_con->origin) * FB_COLS + fb_con->cursor);
+
+    if (fb_hw_cursor == pos) {
+        // 光标移走后又回到原处，硬件不用更新
+        if (fb_cursor_pending) {
+            fb_cursor_writes_skipped += 4;
+            fb_cursor_pending = 0;
+        }
+        return;
+    }
+    outb(FB_COMMAND_PORT, FB_HIGH_BYTE_COMMAND);
+    outb(FB_DATA_PORT,    ((pos >> 8) & 0x00FF));
+    outb(FB_COMMAND_PORT, FB_LOW_BYTE_COMMAND);
+    outb(FB_DATA_PORT,    pos & 0x00FF);
+    fb_hw_cursor = pos;
+    fb_cursor_pending = 0;
+}
+
+// 窗口移动后更新 CRTC 起始地址
+static void fb_sync_origin(void) {
+    u16int start = (u16int) ((fb_con->vram_base + fb_con->origin) * FB_COLS);
+
+    if (fb_hw_origin == start) {
+        return;
+    }
+    outb(FB_COMMAND_PORT, FB_START_HIGH_COMMAND);
+    outb(FB_DATA_PORT,    ((start >> 8) & 0x00FF));
+    outb(FB_COMMAND_PORT, FB_START_LOW_COMMAND);
+    outb(FB_DATA_PORT,    start & 0x00FF);
+    fb_hw_origin = start;
+}
+
+// 与每次移动都写端口相比，省下的端口写入次数
+u32int fb_cursor_writes_avoided(void) {
+    return fb_cursor_writes_skipped;
+}
+
+void fb_write_cell(unsigned int i, char c, unsigned char fg, unsigned char bg) {
+    u8int attr = ((fg & 0x0F) << 4) | (bg & 0x0F);
+    fb_shadow_row(i / FB_COLS)[i % FB_COLS] = (u16int) ((u8int) c | (attr << 8));
+    fb_con->dirty_rows |= 1u << (i / FB_COLS);
+}
+
+// 把所有脏行从影子缓冲区拷贝到显存，再同步起始地址和硬件光标
+void fb_flush(void) {
+    u32int dirty;
+
+    // 后台控制台只写内存，脏行留到切换回来时再刷新
+    if (fb_con != fb_shown) {
+        return;
+    }
+
+    // 正在回看历史时有新输出，先回到实时屏幕
+    if (fb_con->view_offset != 0) {
+        if (fb_con->dirty_rows == 0 &&
+            fb_hw_cursor == (fb_con->vram_base + fb_con->origin) * FB_COLS + fb_con->cursor) {
+            return;
+        }
+        fb_con->view_offset = 0;
+    }
+    if (fb_con->needs_redraw) {
+        fb_con->needs_redraw = 0;
+        fb_con->dirty_rows = FB_ALL_ROWS_DIRTY;
+    }
+
+    dirty = fb_con->dirty_rows;
+    fb_con->dirty_rows = 0;
+    for (u32int row = 0; dirty != 0 && row < FB_ROWS; row++) {
+        if (dirty & (1u << row)) {
+            fb_copy_row(fb_vram_row(row), fb_shadow_row(row));
+            dirty &= ~(1u << row);
+        }
+    }
+
+    fb_sync_origin();
+    fb_sync_cursor();
+}
+
+// 一次写操作结束：立即刷新，或者在延迟模式下留给渲染时机
+static void fb_commit(void) {
+    if (!fb_deferred) {
+        fb_flush();
+    }
+}
+
+void fb_set_deferred(u8int enable) {
+    fb_deferred = enable ? 1 : 0;
+    if (!fb_deferred) {
+        fb_flush();
+    }
+}
+
+// 内容整体上移 rows 行，底部补空行。
+// 滚出顶部的行依次进入历史环；rows 超过一屏时，多出的行先以空行占位，
+// 由 fb_write_buffer 把属于这些行的字符直接写进历史
+static void fb_scroll(u32int rows) {
+    u32int pushed = rows < FB_ROWS ? rows : FB_ROWS;
+
+    for (u32int row = 0; row < pushed; row++) {
+        fb_copy_row(fb_history_append(), fb_shadow_row(row));
+    }
+    if (rows > FB_ROWS) {
+        u32int extra = rows - FB_ROWS;
+        if (extra > FB_HISTORY_LINES) {
+            fb_con->history_next = (fb_con->history_next + extra - FB_HISTORY_LINES) % FB_HISTORY_LINES;
+            extra = FB_HISTORY_LINES;
+        }
+        while (extra-- > 0) {
+            fb_fill_blank(fb_history_append());
+        }
+    }
+
+    if (rows >= FB_ROWS) {
+        for (u32int row = 0; row < FB_ROWS; row++) {
+            fb_clear_row(row);
+        }
+    } else {
+        // 影子环只需移动起点；仍留在屏幕上的行的脏状态随行一起上移
+        fb_con->top = (fb_con->top + rows) % FB_ROWS;
+        fb_con->dirty_rows >>= rows;
+        for (u32int row = FB_ROWS - rows; row < FB_ROWS; row++) {
+            fb_clear_row(row);
+        }
+    }
+
+    if (!fb_hw_scroll) {
+        // 拷贝模式：窗口固定在显存开头，整屏重画
+        fb_con->dirty_rows = FB_ALL_ROWS_DIRTY;
+        return;
+    }
+
+    // 硬件滚动：窗口在显存里下移，只需写新露出的行；
+    // 到达本控制台显存页末尾时回绕到页首，此时整屏重画一次
+    fb_con->origin += rows;
+    if (fb_con->origin + FB_ROWS > FB_CONSOLE_VRAM_ROWS) {
+        fb_con->origin = 0;
+        fb_con->dirty_rows = FB_ALL_ROWS_DIRTY;
+    }
+}
+
+void fb_set_hw_scroll(u8int enable) {
+    fb_hw_scroll = enable ? 1 : 0;
+    if (!fb_hw_scroll) {
+        for (u32int i = 0; i < FB_CONSOLE_COUNT; i++) {
+            if (fb_consoles[i].origin != 0) {
+                fb_consoles[i].origin = 0;
+                fb_consoles[i].dirty_rows = FB_ALL_ROWS_DIRTY;
+            }
+        }
+    }
+    fb_flush();
+}
+
+u8int fb_hw_scroll_enabled(void) {
+    return fb_hw_scroll;
+}
+
+// 按 fb_con->view_offset 把历史和屏幕拼成一页，整页拷贝到显存窗口
+static void fb_render_view(void) {
+    // 历史行与屏幕行连成一个序列：0..count-1 是历史（旧到新），之后是屏幕
+    u32int first = fb_con->history_count - fb_con->view_offset;
+    u32int oldest = (fb_con->history_next + FB_HISTORY_LINES - fb_con->history_count) % FB_HISTORY_LINES;
+
+    for (u32int row = 0; row < FB_ROWS; row++) {
+        u32int index = first + row;
+        const u16int *src;
+
+        if (index < fb_con->history_count) {
+            src = fb_con->history[(oldest + index) % FB_HISTORY_LINES];
+        } else {
+            src = fb_shadow_row(index - fb_con->history_count);
+        }
+        fb_copy_row(fb_vram_row(row), src);
+    }
+    // 实时内容已被覆盖，返回时需要整屏重画
+    fb_con->needs_redraw = 1;
+}
+
+// 向上（lines > 0）或向下（lines < 0）回看历史
+void fb_scrollback(s32int lines) {
+    s32int offset = (s32int) fb_con->view_offset + lines;
+
+    if (fb_con != fb_shown) {
+        return;
+    }
+
+    if (offset < 0) {
+        offset = 0;
+    }
+    if ((u32int) offset > fb_con->history_count) {
+        offset = (s32int) fb_con->history_count;
+    }
+    if ((u32int) offset == fb_con->view_offset) {
+        return;
+    }
+
+    // 开始回看前先把尚未刷新的输出写到显存，否则下一次刷新会当作新输出跳回
+    if (fb_con->view_offset == 0) {
+        fb_flush();
+    }
+
+    fb_con->view_offset = (u32int) offset;
+    if (fb_con->view_offset == 0) {
+        fb_flush();
+    } else {
+        fb_render_view();
+    }
+}
+
+void fb_page_up(void) {
+    fb_scrollback(FB_ROWS - 1);
+}
+
+void fb_page_down(void) {
+    fb_scrollback(-(FB_ROWS - 1));
+}
+
+// 写一个字符到影子缓冲区，不刷新显存
+static void fb_put_char(char c) {
+    // 处理换行符
+    if (c == '\n') {
+        fb_put_newline();
+        return;
+    }
+
+    // 处理回车符
+    if (c == '\r') {
+        unsigned int current_row = fb_con->cursor / FB_COLS;
+        fb_move_cursor(current_row * FB_COLS);
+        return;
+    }
+
+    // 正常字符
+    fb_write_cell(fb_con->cursor, c, FB_WHITE, FB_BLACK);
+
+    // 检查是否需要换行（到达行尾）
+    if (fb_con->cursor + 1 >= FB_CELLS) {
+        // 改为滚动而不是清屏
+        fb_put_newline();  // 这会处理滚动
+    } else {
+        fb_move_cursor(fb_con->cursor + 1);
+    }
+}
+
+static void fb_put_newline(void) {
+    // 计算当前行，每行80个字符
+    unsigned int current_row = fb_con->cursor / FB_COLS;
+
+    // 如果超出屏幕底部，需要滚动屏幕
+    if (current_row + 1 >= FB_ROWS) {
+        fb_scroll(1);
+        // 光标移动到最后一行的开头
+        fb_move_cursor(FB_COLS * (FB_ROWS - 1));
+        return;
+    }
+
+    // 移动到下一行开头
+    fb_move_cursor((current_row + 1) * FB_COLS);
+}
+
+// 正在显示的控制台的输出同步到串口
+static void fb_mirror(const char* buf, u32int len) {
+    if (fb_con == fb_shown) {
+        serial_write(buf, len);
+    }
+}
+
+void fb_write_char(char c) {
+    fb_mirror(&c, 1);
+    fb_put_char(c);
+    fb_commit();
+}
+
+// 批量输出：先算出整批输出后屏幕最终要滚动的行数 K，一次滚动 K 行，
+// 再只渲染最终仍留在屏幕上的字符，开销与最终显示的内容成正比
+void fb_write_buffer(const char* buf, u32int len) {
+    u32int start_line = fb_con->cursor / FB_COLS;
+    u32int line = start_line;
+    u32int col = fb_con->cursor % FB_COLS;
+    u32int scroll = 0;
+    u32int history_base = fb_con->history_next;
+
+    fb_mirror(buf, len);
+
+    // 第一遍：只模拟光标移动（与 fb_put_char 的换行规则一致）
+    for (u32int i = 0; i < len; i++) {
+        char c = buf[i];
+        if (c == '\n') {
+            line++;
+            col = 0;
+        } else if (c == '\r') {
+            col = 0;
+        } else if (++col == FB_COLS) {
+            line++;
+            col = 0;
+        }
+    }
+    if (line >= FB_ROWS) {
+        scroll = line - (FB_ROWS - 1);
+        fb_scroll(scroll);
+    }
+
+    // 第二遍：跳过会被滚出屏幕的行，其余字符直接写入影子缓冲区
+    line = start_line;
+    col = fb_con->cursor % FB_COLS;
+    for (u32int i = 0; i < len; i++) {
+        char c = buf[i];
+        if (c == '\n') {
+            line++;
+            col = 0;
+            continue;
+        }
+        if (c == '\r') {
+            col = 0;
+            continue;
+        }
+        if (line >= scroll) {
+            fb_write_cell((line - scroll) * FB_COLS + col, c, FB_WHITE, FB_BLACK);
+        } else if (scroll - line <= FB_HISTORY_LINES) {
+            // 该行已滚出屏幕，直接写入它在历史环中的位置
+            u8int attr = ((FB_WHITE & 0x0F) << 4) | (FB_BLACK & 0x0F);
+            u32int slot = (history_base + line) % FB_HISTORY_LINES;
+            fb_con->history[slot][col] = (u16int) ((u8int) c | (attr << 8));
+        }
+        if (++col == FB_COLS) {
+            line++;
+            col = 0;
+        }
+    }
+
+    fb_move_cursor((line - scroll) * FB_COLS + col);
+    fb_commit();
+}
+
+void fb_write_string(const char* str) {
+    u32int len = 0;
+    while (str[len]) {
+        len++;
+    }
+    fb_write_buffer(str, len);
+}
+
+void fb_backspace(void) {
+    if (fb_con->cursor > 0) {
+        // 用空格覆盖上一个字符
+        fb_write_cell(fb_con->cursor - 1, ' ', FB_WHITE, FB_BLACK);
+        fb_move_cursor(fb_con->cursor - 1);
+        fb_commit();
+        fb_mirror("\b \b", 3);
+    }
+}
+
+void fb_cursor_shift(s32int delta) {
+    s32int pos = (s32int) fb_con->cursor + delta;
+    char seq[16];
+    u32int len = 0;
+    u32int count = (u32int) (delta < 0 ? -delta : delta);
+    char digits[10];
+    u32int n = sizeof(digits);
+
+    if (delta == 0) {
+        return;
+    }
+    if (pos < 0) {
+        pos = 0;
+    } else if (pos >= FB_CELLS) {
+        pos = FB_CELLS - 1;
+    }
+    fb_move_cursor((u16int) pos);
+    fb_commit();
+
+    // 串口端没有固定行宽，用 ANSI 的光标左移/右移序列同步
+    do {
+        digits[--n] = '0' + (count % 10);
+        count /= 10;
+    } while (count > 0);
+    seq[len++] = 0x1B;
+    seq[len++] = '[';
+    while (n < sizeof(digits)) {
+        seq[len++] = digits[n++];
+    }
+    seq[len++] = delta < 0 ? 'D' : 'C';
+    fb_mirror(seq, len);
+}
+
+void fb_newline(void) {
+    fb_mirror("\n", 1);
+    fb_put_newline();
+    fb_commit();
+}
+
+// 首次使用的控制台先清成空白，并整页标脏
+static void fb_console_prepare(struct fb_console *con) {
+    if (con->ready) {
+        return;
+    }
+    con->ready = 1;
+    con->vram_base = (u32int) (con - fb_consoles) * FB_CONSOLE_VRAM_ROWS;
+    for (u32int row = 0; row < FB_ROWS; row++) {
+        fb_fill_blank(&con->shadow[row * FB_COLS]);
+    }
+    con->dirty_rows = FB_ALL_ROWS_DIRTY;
+}
+
+// 只改变输出目标，不改变显示；后台控制台的输出只写内存
+void fb_console_select(u32int index) {
+    if (index >= FB_CONSOLE_COUNT) {
+        return;
+    }
+    fb_con = &fb_consoles[index];
+    fb_console_prepare(fb_con);
+}
+
+// 显示另一个控制台：只需把 CRTC 起始地址指向它的显存页，
+// 再补上它在后台期间产生的脏行
+void fb_console_switch(u32int index) {
+    if (index >= FB_CONSOLE_COUNT) {
+        return;
+    }
+    fb_console_select(index);
+    if (fb_shown->view_offset != 0) {
+        fb_shown->view_offset = 0;
+        fb_shown->needs_redraw = 1;
+    }
+    fb_shown = fb_con;
+    fb_flush();
+}
+
+u32int fb_console_current(void) {
+    return (u32int) (fb_con - fb_consoles);
+}
+
+void fb_clear(void) {
+    fb_console_prepare(fb_con);
+    for (u32int row = 0; row < FB_ROWS; row++) {
+        fb_clear_row(row);
+    }
+    fb_move_cursor(0);
+    fb_commit();
+}
+
+void fb_write_hex(u8int value) {
+    char hex_chars[] = "0123456789ABCDEF";
+    char text[2];
+
+    text[0] = hex_chars[(value >> 4) & 0x0F];
+    text[1] = hex_chars[value & 0x0F];
+    fb_write_buffer(text, 2);
+}
+
+void fb_write_dec(u32int value) {
+    char digits[10];
+    u32int n = sizeof(digits);
+
+    do {
+        digits[--n] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    fb_write_buffer(&digits[n], sizeof(digits) - n);
+}
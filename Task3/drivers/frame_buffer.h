@@ -1,36 +1,73 @@
-#ifndef INCLUDE_FRAME_BUFFER_H
-#define INCLUDE_FRAME_BUFFER_H
-
-#include "types.h"
-
-/* Frame buffer colors */
-#define FB_BLACK         0
-#define FB_BLUE          1
-#define FB_GREEN         2
-#define FB_CYAN          3
-#define FB_RED           4
-#define FB_MAGENTA       5
-#define FB_BROWN         6
-#define FB_LIGHT_GREY    7
-#define FB_DARK_GREY     8
-#define FB_LIGHT_BLUE    9
-#define FB_LIGHT_GREEN   10
-#define FB_LIGHT_CYAN    11
-#define FB_LIGHT_RED     12
-#define FB_LIGHT_MAGENTA 13
-#define FB_LIGHT_BROWN   14
-#define FB_WHITE         15
-
-// 声明光标位置为全局变量
-extern u16int cursor_pos;
-
-void fb_move_cursor(unsigned short pos);
-void fb_write_cell(unsigned int i, char c, unsigned char fg, unsigned char bg);
-void fb_write_char(char c);
-void fb_write_string(const char* str);
-void fb_backspace(void);
-void fb_newline(void);
-void fb_clear(void);
-void fb_write_hex(u8int value);
-
+#ifndef INCLUDE_FRAME_BUFFER_H
+#define INCLUDE_FRAME_BUFFER_H
+
+#include "types.h"
+
+/* Frame buffer colors */
+#define FB_BLACK         0
+#define FB_BLUE          1
+#define FB_GREEN         2
+#define FB_CYAN          3
+#define FB_RED           4
+#define FB_MAGENTA       5
+#define FB_BROWN         6
+#define FB_LIGHT_GREY    7
+#define FB_DARK_GREY     8
+#define FB_LIGHT_BLUE    9
+#define FB_LIGHT_GREEN   10
+#define FB_LIGHT_CYAN    11
+#define FB_LIGHT_RED     12
+#define FB_LIGHT_MAGENTA 13
+#define FB_LIGHT_BROWN   14
+#define FB_WHITE         15
+
+/* Text mode geometry */
+#define FB_COLS          80
+#define FB_ROWS          25
+#define FB_CELLS         (FB_COLS * FB_ROWS)
+
+/* Scrollback history size in lines (per console) */
+#define FB_HISTORY_LINES 4096
+
+/* Number of virtual consoles */
+#define FB_CONSOLE_COUNT 4
+
+void fb_move_cursor(unsigned short pos);
+void fb_write_cell(unsigned int i, char c, unsigned char fg, unsigned char bg);
+void fb_write_char(char c);
+void fb_write_string(const char* str);
+// 一次输出 len 个字符，多行滚动合并为一次
+void fb_write_buffer(const char* buf, u32int len);
+void fb_backspace(void);
+// 光标沿行序前后移动 delta 个单元，不改变内容（行编辑使用）
+void fb_cursor_shift(s32int delta);
+void fb_newline(void);
+void fb_clear(void);
+void fb_write_hex(u8int value);
+void fb_write_dec(u32int value);
+
+// 把影子缓冲区中的脏行刷新到显存，并同步硬件光标（fb_write_* 结束时会自动调用）
+void fb_flush(void);
+
+// 延迟刷新：1 = fb_write_* 只写内存，显存在空闲时或调用 fb_flush 时才更新
+void fb_set_deferred(u8int enable);
+
+// 滚动模式：1 = 通过 CRTC 起始地址寄存器在显存中平移窗口（默认），
+// 0 = 窗口固定在显存开头，滚动时整屏拷贝
+void fb_set_hw_scroll(u8int enable);
+u8int fb_hw_scroll_enabled(void);
+
+// 回看滚出屏幕的历史：lines > 0 向上，lines < 0 向下；有新输出时自动回到底部
+void fb_scrollback(s32int lines);
+void fb_page_up(void);
+void fb_page_down(void);
+
+// 虚拟控制台：switch 切换显示并把输出指向它，select 只改变输出目标
+void fb_console_switch(u32int index);
+void fb_console_select(u32int index);
+u32int fb_console_current(void);
+
+// fb_move_cursor 只改软件光标，此函数返回因此省下的 CRTC 端口写入次数
+u32int fb_cursor_writes_avoided(void);
+
 #endif /* INCLUDE_FRAME_BUFFER_H */
\ No newline at end of file
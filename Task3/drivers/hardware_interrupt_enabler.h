@@ -1,7 +1,13 @@
-#ifndef INCLUDE_HARDWARE_INTERRUPT_ENABLER_H
-#define INCLUDE_HARDWARE_INTERRUPT_ENABLER_H
-
-void enable_hardware_interrupts();
-void disable_hardware_interrupts();
-
+#ifndef INCLUDE_HARDWARE_INTERRUPT_ENABLER_H
+#define INCLUDE_HARDWARE_INTERRUPT_ENABLER_H
+
+#define EFLAGS_IF 0x200  // EFLAGS 中的中断允许位
+
+void enable_hardware_interrupts();
+void disable_hardware_interrupts();
+
+// 关中断并返回原来的 EFLAGS，配合 restore_hardware_interrupts 使用
+unsigned int save_and_disable_hardware_interrupts();
+void restore_hardware_interrupts(unsigned int flags);
+
 #endif /* INCLUDE_HARDWARE_INTERRUPT_ENABLER_H */
\ No newline at end of file
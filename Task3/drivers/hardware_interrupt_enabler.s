@@ -1,11 +1,33 @@
-global enable_hardware_interrupts
-
-enable_hardware_interrupts:
-    sti
-    ret
-
-global disable_hardware_interrupts
-
-disable_hardware_interrupts:
-    cli
+global enable_hardware_interrupts
+
+enable_hardware_interrupts:
+    sti
+    ret
+
+global disable_hardware_interrupts
+
+disable_hardware_interrupts:
+    cli
+    ret
+
+global save_and_disable_hardware_interrupts
+
+; save_and_disable_hardware_interrupts - returns the current EFLAGS and
+; disables interrupts, for short critical sections that may run with
+; interrupts already off
+save_and_disable_hardware_interrupts:
+    pushfd
+    pop eax
+    cli
+    ret
+
+global restore_hardware_interrupts
+
+; restore_hardware_interrupts - restores the interrupt flag saved above
+; stack: [esp + 4] the saved EFLAGS
+;        [esp    ] the return address
+restore_hardware_interrupts:
+    mov eax, [esp + 4]
+    push eax
+    popfd
     ret
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "history.h"
+
+#define HISTORY_BYTES_MASK   (HISTORY_BYTES - 1)
+#define HISTORY_ENTRIES_MASK (HISTORY_ENTRIES - 1)
+
+// 文本环中的字节和每条命令的起点都用自由增长的计数表示，下标用掩码取得。
+// 第 i 条命令（i 在 [first, next) 之间）从 start[i] 开始，到 start[i + 1]
+// （最新一条到 end）为止
+static struct {
+    char text[HISTORY_BYTES];
+    u32int start[HISTORY_ENTRIES];
+    u32int first;   // 最老一条的序号
+    u32int next;    // 下一条的序号
+    u32int end;     // 文本写到的位置
+} history;
+
+static u32int history_entry_start(u32int index) {
+    return history.start[index & HISTORY_ENTRIES_MASK];
+}
+
+static u32int history_entry_end(u32int index) {
+    return index + 1 == history.next ? history.end : history_entry_start(index + 1);
+}
+
+static char history_byte(u32int offset) {
+    return history.text[offset & HISTORY_BYTES_MASK];
+}
+
+u32int history_count(void) {
+    return history.next - history.first;
+}
+
+// 与最新一条命令相同时返回 1
+static u8int history_same_as_last(const char* line, u32int len) {
+    u32int start;
+
+    if (history_count() == 0) {
+        return 0;
+    }
+    start = history_entry_start(history.next - 1);
+    if (history.end - start != len) {
+        return 0;
+    }
+    for (u32int i = 0; i < len; i++) {
+        if (history_byte(start + i) != line[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void history_add(const char* line, u32int len) {
+    if (len == 0 || len > HISTORY_BYTES || history_same_as_last(line, len)) {
+        return;
+    }
+
+    // 淘汰最老的命令，直到条数和文本空间都够用
+    while (history_count() > 0 &&
+           (history_count() >= HISTORY_ENTRIES ||
+            history.end + len - history_entry_start(history.first) > HISTORY_BYTES)) {
+        history.first++;
+    }
+
+    history.start[history.next & HISTORY_ENTRIES_MASK] = history.end;
+    for (u32int i = 0; i < len; i++) {
+        history.text[(history.end + i) & HISTORY_BYTES_MASK] = line[i];
+    }
+    history.end += len;
+    history.next++;
+}
+
+s32int history_get(u32int age, char* buf, u32int size) {
+    u32int index;
+    u32int start;
+    u32int len;
+
+    if (age >= history_count() || size == 0) {
+        return -1;
+    }
+    index = history.next - 1 - age;
+    start = history_entry_start(index);
+    len = history_entry_end(index) - start;
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    for (u32int i = 0; i < len; i++) {
+        buf[i] = history_byte(start + i);
+    }
+    buf[len] = '\0';
+    return (s32int) len;
+}
+
+// 第 index 条命令中是否包含 needle
+static u8int history_contains(u32int index, const char* needle, u32int len) {
+    u32int start = history_entry_start(index);
+    u32int end = history_entry_end(index);
+
+    if (len == 0) {
+        return 1;
+    }
+    // 先比较首字符，只有首字符相同的位置才逐字比较
+    for (u32int at = start; at + len <= end; at++) {
+        if (history_byte(at) != needle[0]) {
+            continue;
+        }
+        u32int i = 1;
+        while (i < len && history_byte(at + i) == needle[i]) {
+            i++;
+        }
+        if (i == len) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+s32int history_search(const char* needle, u32int len, u32int age) {
+    for (; age < history_count(); age++) {
+        if (history_contains(history.next - 1 - age, needle, len)) {
+            return (s32int) age;
+        }
+    }
+    return -1;
+}
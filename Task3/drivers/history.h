@@ -0,0 +1,24 @@
+#ifndef INCLUDE_HISTORY_H
+#define INCLUDE_HISTORY_H
+
+#include "types.h"
+
+#define HISTORY_BYTES   4096  // 保存命令文本的环大小（2 的幂）
+#define HISTORY_ENTRIES 256   // 最多保存的命令条数（2 的幂）
+
+// 命令历史：最近的命令首尾相接地存放在固定大小的字节环中，
+// 空间或条数不够时淘汰最老的命令
+
+// 追加一条命令；空行和与上一条相同的命令不保存
+void history_add(const char* line, u32int len);
+
+// 当前保存的命令条数
+u32int history_count(void);
+
+// 取出倒数第 age 条命令（0 = 最新），返回长度；不存在时返回 -1
+s32int history_get(u32int age, char* buf, u32int size);
+
+// 从倒数第 age 条开始向更老的命令查找包含 needle 的一条，返回其 age；找不到返回 -1
+s32int history_search(const char* needle, u32int len, u32int age);
+
+#endif /* INCLUDE_HISTORY_H */
@@ -0,0 +1,28 @@
+#include "idle.h"
+#include "klog.h"
+#include "frame_buffer.h"
+#include "keyboard.h"
+#include "serial.h"
+#include "input_buffer.h"
+#include "ktimer.h"
+
+void idle_work(void) {
+    // 键盘和串口中断只保存原始字节，在这里转换后放入输入缓冲区。
+    // 两者都在主循环中运行，输入缓冲区因此只有一个写入方
+    keyboard_process();
+    serial_process();
+
+    // 时钟中断只检查最近的到期时间，定时器回调在这里成批运行
+    ktimer_run();
+
+    // 命令输出只写入影子缓冲区，空闲时一次性渲染到显存
+    fb_flush();
+
+    // 日志在中断或命令中只写入内存，空闲时再慢慢输出到串口
+    klog_drain();
+}
+
+void idle_notify(void) {
+    // 主循环空闲时睡在 readline 的输入事件上
+    input_notify();
+}
@@ -0,0 +1,10 @@
+#ifndef INCLUDE_IDLE_H
+#define INCLUDE_IDLE_H
+
+// 在 CPU 空闲（准备 hlt）时执行被推迟的工作，例如刷新控制台和输出内核日志
+void idle_work(void);
+
+// 唤醒睡眠中的主循环，让它执行一次空闲工作（可以在中断处理程序中调用）
+void idle_notify(void);
+
+#endif /* INCLUDE_IDLE_H */
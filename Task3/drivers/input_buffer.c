@@ -1,95 +1,516 @@
-#include "input_buffer.h"
-#include "io.h"
-#include "frame_buffer.h"
-
-// 循环缓冲区结构
-static struct {
-    u8int buffer[INPUT_BUFFER_SIZE];
-    u32int read_index;
-    u32int write_index;
-    u32int count;  // 当前缓冲区中的字符数
-} input_buffer;
-
-// 初始化输入缓冲区
-void input_buffer_init(void) {
-    input_buffer.read_index = 0;
-    input_buffer.write_index = 0;
-    input_buffer.count = 0;
-}
-
-// 向缓冲区添加一个字符
-void buffer_put(u8int c) {
-    if (input_buffer.count >= INPUT_BUFFER_SIZE) {
-        // 缓冲区已满，丢弃最老的字符
-        input_buffer.read_index = (input_buffer.read_index + 1) % INPUT_BUFFER_SIZE;
-        input_buffer.count--;
-    }
-    
-    input_buffer.buffer[input_buffer.write_index] = c;
-    input_buffer.write_index = (input_buffer.write_index + 1) % INPUT_BUFFER_SIZE;
-    input_buffer.count++;
-}
-
-// 从缓冲区获取一个字符（非阻塞）
-u8int getc(void) {
-    if (input_buffer.count == 0) {
-        return 0;  // 缓冲区为空
-    }
-    
-    u8int c = input_buffer.buffer[input_buffer.read_index];
-    input_buffer.read_index = (input_buffer.read_index + 1) % INPUT_BUFFER_SIZE;
-    input_buffer.count--;
-    
-    return c;
-}
-
-// 检查缓冲区中是否有数据
-u32int input_available(void) {
-    return input_buffer.count;
-}
-
-// 读取一行输入
-u32int readline(char* buf, u32int max_len) {
-    u32int index = 0;
-    u8int c;
-    
-    if (max_len == 0) {
-        return 0;
-    }
-    
-    buf[0] = '\0';
-    
-    while (index < max_len - 1) {
-        c = getc();
-        
-        if (c == 0) {
-            // 没有可用字符时使用HLT节省CPU
-            __asm__ __volatile__("hlt");
-            continue;
-        }
-        
-        // 处理回车键
-        if (c == '\n') {
-            buf[index] = '\0';
-            return index;
-        }
-        
-        // 处理退格键
-        if (c == '\b') {
-            if (index > 0) {
-                index--;
-                fb_backspace();
-            }
-            continue;
-        }
-        
-        // 常规字符
-        if (c >= 32 && c <= 126) {
-            buf[index++] = c;
-            fb_write_char(c);
-        }
-    }
-    
-    buf[index] = '\0';
-    return index;
-}
\ No newline at end of file
+#include "input_buffer.h"
+#include "io.h"
+#include "frame_buffer.h"
+#include "keyboard.h"
+#include "idle.h"
+#include "wait.h"
+#include "klog.h"
+#include "history.h"
+
+#define INPUT_BUFFER_MASK (INPUT_BUFFER_SIZE - 1)
+
+#define input_barrier() __asm__ __volatile__("" : : : "memory")
+
+// 单生产者/单消费者环形缓冲区：head 只由写入方推进，tail 只由读取方推进。
+// 两个计数器自由增长（回绕也没关系），下标用掩码取得，没有双方共享修改的计数
+static struct {
+    u32int buffer[INPUT_BUFFER_SIZE];
+    volatile u32int head;
+    volatile u32int tail;
+} input_buffer;
+
+// 输入到达事件，以及 readline 上次看到的事件计数
+static struct wait_event input_arrived;
+static u32int input_seen = 0;
+
+// 统计计数只由写入方修改
+static struct input_stats input_counters;
+
+// 上一次放入是否有丢弃，用来只在开始丢弃时记一条日志
+static u8int input_dropping = 0;
+
+// 初始化输入缓冲区
+void input_buffer_init(void) {
+    input_buffer.head = 0;
+    input_buffer.tail = 0;
+}
+
+// 记录一次放入的结果
+static void input_account(u32int source, u32int requested, u32int stored, u32int used) {
+    u32int dropped = requested - stored;
+
+    input_counters.enqueued += stored;
+    input_counters.source_enqueued[source] += stored;
+    if (used > input_counters.high_water) {
+        input_counters.high_water = used;
+    }
+
+    if (dropped > 0) {
+        input_counters.dropped += dropped;
+        input_counters.source_dropped[source] += dropped;
+        if (!input_dropping) {
+            klog(KLOG_WARN, "input buffer full, dropping input");
+        }
+    }
+    input_dropping = dropped > 0;
+}
+
+// 向缓冲区添加最多 count 个按键事件，返回实际放入的个数
+u32int buffer_putn(u32int source, const u32int* events, u32int count) {
+    u32int head = input_buffer.head;
+    u32int used = head - input_buffer.tail;
+    u32int space = INPUT_BUFFER_SIZE - used;
+    u32int stored = count;
+
+    // 读取方拥有 tail，写入方不能丢弃最老的事件，缓冲区满时丢弃新事件
+    if (stored > space) {
+        stored = space;
+    }
+    for (u32int i = 0; i < stored; i++) {
+        input_buffer.buffer[(head + i) & INPUT_BUFFER_MASK] = events[i];
+    }
+
+    // 先写数据再发布 head
+    input_barrier();
+    input_buffer.head = head + stored;
+
+    input_account(source < INPUT_SOURCE_COUNT ? source : INPUT_SOURCE_OTHER, count, stored, used + stored);
+    return stored;
+}
+
+// 向缓冲区添加一个按键事件
+void buffer_put_event(u32int source, u32int event) {
+    buffer_putn(source, &event, 1);
+}
+
+// 向缓冲区添加一个字符
+void buffer_put(u8int c) {
+    buffer_put_event(INPUT_SOURCE_OTHER, KEYBOARD_EVENT(c, 0, 0));
+}
+
+void input_get_stats(struct input_stats* stats) {
+    *stats = input_counters;
+}
+
+// 从缓冲区取出最多 count 个按键事件，返回实际取出的个数
+u32int buffer_getn(u32int* events, u32int count) {
+    u32int tail = input_buffer.tail;
+    u32int available = input_buffer.head - tail;
+
+    if (count > available) {
+        count = available;
+    }
+
+    // 先读 head 再读数据
+    input_barrier();
+    for (u32int i = 0; i < count; i++) {
+        events[i] = input_buffer.buffer[(tail + i) & INPUT_BUFFER_MASK];
+    }
+
+    // 数据读完后才释放空间
+    input_barrier();
+    input_buffer.tail = tail + count;
+    return count;
+}
+
+// 从缓冲区获取一个按键事件（非阻塞）
+u32int getkey(void) {
+    u32int event;
+
+    if (buffer_getn(&event, 1) == 0) {
+        return 0;  // 缓冲区为空
+    }
+    return event;
+}
+
+// 从缓冲区获取一个字符（非阻塞）
+u8int getc(void) {
+    u32int event;
+
+    while ((event = getkey()) != 0) {
+        u32int code = KEYBOARD_EVENT_CODE(event);
+        if (!(event & KEYBOARD_EVENT_RELEASED) && code < 0x80) {
+            return (u8int) code;
+        }
+    }
+    return 0;
+}
+
+void input_notify(void) {
+    wait_event_signal(&input_arrived);
+}
+
+// 检查缓冲区中是否有数据
+u32int input_available(void) {
+    return input_buffer.head - input_buffer.tail;
+}
+
+// Ctrl+K：删除光标到行尾
+#define LINE_KILL_TO_END 0x0B
+// Ctrl+R：向前搜索历史命令；Ctrl+G / Esc：取消搜索
+#define LINE_REVERSE_SEARCH 0x12
+#define LINE_CANCEL         0x07
+#define LINE_ESCAPE         0x1B
+
+#define LINE_QUERY_SIZE 32
+
+// 每个虚拟控制台各自保存正在编辑的一行，切换控制台时互不干扰。
+// 屏幕光标总是停在 buf[pos] 上
+static struct line_state {
+    char buf[LINE_BUFFER_SIZE];
+    u32int len;
+    u32int pos;
+
+    // 正在查看的历史命令：0 表示新输入的行，n 表示倒数第 n 条（age = n - 1）；
+    // draft 是开始翻历史前输入的内容
+    u32int recall;
+    char draft[LINE_BUFFER_SIZE];
+    u32int draft_len;
+
+    // 增量搜索：searching 时 buf 中显示的是搜索提示，draft 保存搜索前的行
+    u8int searching;
+    u8int failed;
+    char query[LINE_QUERY_SIZE];
+    u32int query_len;
+    s32int match;
+} lines[FB_CONSOLE_COUNT];
+
+// 从光标处重画到行尾，再用 erase 个空格擦掉行尾留下的旧字符，最后把光标移回原处。
+// 重画的单元数与改动的位置成正比，与整行长度无关
+static void line_redraw(struct line_state* line, u32int erase) {
+    char blanks[LINE_BUFFER_SIZE];
+    u32int tail = line->len - line->pos;
+
+    for (u32int i = 0; i < erase; i++) {
+        blanks[i] = ' ';
+    }
+    if (tail > 0) {
+        fb_write_buffer(&line->buf[line->pos], tail);
+    }
+    if (erase > 0) {
+        fb_write_buffer(blanks, erase);
+    }
+    fb_cursor_shift(-(s32int) (tail + erase));
+}
+
+// 在光标处插入一个字符
+static void line_insert(struct line_state* line, char c, u32int max_len) {
+    if (line->len >= max_len - 1) {
+        return;  // 行已满
+    }
+    for (u32int i = line->len; i > line->pos; i--) {
+        line->buf[i] = line->buf[i - 1];
+    }
+    line->buf[line->pos++] = c;
+    line->len++;
+    fb_write_char(c);
+
+    // 在行尾追加时只需输出这一个字符，否则重画后面被右移的部分
+    if (line->pos < line->len) {
+        line_redraw(line, 0);
+    }
+}
+
+// 删除光标处的字符（Delete）
+static void line_delete(struct line_state* line) {
+    if (line->pos >= line->len) {
+        return;
+    }
+    for (u32int i = line->pos; i + 1 < line->len; i++) {
+        line->buf[i] = line->buf[i + 1];
+    }
+    line->len--;
+    line_redraw(line, 1);
+}
+
+// 删除光标前的字符（退格）
+static void line_backspace(struct line_state* line) {
+    if (line->pos == 0) {
+        return;
+    }
+    if (line->pos == line->len) {
+        line->pos--;
+        line->len--;
+        fb_backspace();
+        return;
+    }
+    line->pos--;
+    fb_cursor_shift(-1);
+    line_delete(line);
+}
+
+// 删除光标到行尾的内容（Ctrl+K）
+static void line_kill(struct line_state* line) {
+    u32int erase = line->len - line->pos;
+
+    if (erase == 0) {
+        return;
+    }
+    line->len = line->pos;
+    line_redraw(line, erase);
+}
+
+// 移动光标到 pos（左右键、Home、End）
+static void line_move(struct line_state* line, u32int pos) {
+    if (pos > line->len) {
+        pos = line->len;
+    }
+    fb_cursor_shift((s32int) pos - (s32int) line->pos);
+    line->pos = pos;
+}
+
+// 用 text 替换整行内容，光标放在行尾
+static void line_replace(struct line_state* line, const char* text, u32int len, u32int max_len) {
+    u32int old_len = line->len;
+
+    if (len > max_len - 1) {
+        len = max_len - 1;
+    }
+    line_move(line, 0);
+    for (u32int i = 0; i < len; i++) {
+        line->buf[i] = text[i];
+    }
+    line->len = len;
+    line_redraw(line, old_len > len ? old_len - len : 0);
+    line_move(line, len);
+}
+
+// 保存当前输入的行，翻历史或搜索结束后可以恢复
+static void line_save_draft(struct line_state* line) {
+    for (u32int i = 0; i < line->len; i++) {
+        line->draft[i] = line->buf[i];
+    }
+    line->draft_len = line->len;
+}
+
+// 上/下键：切换到更老/更新的一条历史命令，回到最新之后恢复原来输入的内容
+static void line_history_step(struct line_state* line, s32int step, u32int max_len) {
+    char entry[LINE_BUFFER_SIZE];
+    s32int recall = (s32int) line->recall + step;
+    s32int len;
+
+    if (recall <= 0) {
+        if (line->recall > 0) {
+            line->recall = 0;
+            line_replace(line, line->draft, line->draft_len, max_len);
+        }
+        return;
+    }
+    len = history_get((u32int) recall - 1, entry, sizeof(entry));
+    if (len < 0) {
+        return;  // 没有更老的命令
+    }
+    if (line->recall == 0) {
+        line_save_draft(line);
+    }
+    line->recall = (u32int) recall;
+    line_replace(line, entry, (u32int) len, max_len);
+}
+
+// 把搜索提示和当前匹配的命令显示在行中
+static void line_search_show(struct line_state* line) {
+    static const char ok_prefix[] = "(reverse-i-search)`";
+    static const char failed_prefix[] = "(failed reverse-i-search)`";
+    char display[LINE_BUFFER_SIZE];
+    const char* prefix = line->failed ? failed_prefix : ok_prefix;
+    u32int len = 0;
+
+    while (*prefix) {
+        display[len++] = *prefix++;
+    }
+    for (u32int i = 0; i < line->query_len; i++) {
+        display[len++] = line->query[i];
+    }
+    display[len++] = '\'';
+    display[len++] = ':';
+    display[len++] = ' ';
+    if (line->match >= 0) {
+        s32int n = history_get((u32int) line->match, &display[len], sizeof(display) - len);
+        len += n > 0 ? (u32int) n : 0;
+    }
+    line_replace(line, display, len, LINE_BUFFER_SIZE);
+}
+
+// 从 age 开始向更老的命令查找当前搜索词
+static void line_search_from(struct line_state* line, u32int age) {
+    s32int match = history_search(line->query, line->query_len, age);
+
+    if (match >= 0) {
+        line->match = match;
+    }
+    line->failed = match < 0;
+}
+
+// 结束搜索：accept 为 1 时把匹配的命令放入行中，否则恢复搜索前的内容
+static void line_search_end(struct line_state* line, u8int accept, u32int max_len) {
+    char entry[LINE_BUFFER_SIZE];
+    s32int len;
+
+    line->searching = 0;
+    if (accept && line->match >= 0 &&
+        (len = history_get((u32int) line->match, entry, sizeof(entry))) >= 0) {
+        line->recall = (u32int) line->match + 1;
+        line_replace(line, entry, (u32int) len, max_len);
+        return;
+    }
+    line->recall = 0;
+    line_replace(line, line->draft, line->draft_len, max_len);
+}
+
+// 搜索模式下的按键；返回 1 表示已处理，0 表示已结束搜索、按键继续按普通编辑处理
+static u8int line_search_key(struct line_state* line, u32int code, u32int max_len) {
+    if (code == LINE_REVERSE_SEARCH) {
+        // 再按一次 Ctrl+R：继续找更老的匹配
+        if (line->match >= 0) {
+            line_search_from(line, (u32int) line->match + 1);
+        }
+    } else if (code == LINE_CANCEL || code == LINE_ESCAPE) {
+        line_search_end(line, 0, max_len);
+        return 1;
+    } else if (code == '\b') {
+        if (line->query_len > 0) {
+            line->query_len--;
+        }
+        line->match = -1;
+        line_search_from(line, 0);
+    } else if (code >= 32 && code <= 126) {
+        // 搜索词变长时，新的匹配只可能在当前匹配或更老的命令中
+        if (line->query_len < LINE_QUERY_SIZE) {
+            line->query[line->query_len++] = (char) code;
+        }
+        line_search_from(line, line->match >= 0 ? (u32int) line->match : 0);
+    } else {
+        line_search_end(line, 1, max_len);
+        return 0;
+    }
+    line_search_show(line);
+    return 1;
+}
+
+// 开始增量搜索
+static void line_search_start(struct line_state* line) {
+    line_save_draft(line);
+    line->searching = 1;
+    line->failed = 0;
+    line->query_len = 0;
+    line->match = -1;
+    line_search_show(line);
+}
+
+// 把控制台 console 上已输入的一行交给调用者，并清空该行
+static u32int take_line(u32int console, char* buf) {
+    struct line_state* line = &lines[console];
+    u32int len = line->len;
+
+    // 光标可能在行中间，先移到行尾再换行
+    line_move(line, len);
+    for (u32int i = 0; i < len; i++) {
+        buf[i] = line->buf[i];
+    }
+    buf[len] = '\0';
+    line->len = 0;
+    line->pos = 0;
+    line->recall = 0;
+    history_add(buf, len);
+    return len;
+}
+
+// 读取一行输入（在当前显示的控制台上）
+u32int readline(char* buf, u32int max_len) {
+    u32int event;
+    u32int code;
+    
+    if (max_len == 0) {
+        return 0;
+    }
+    if (max_len > LINE_BUFFER_SIZE) {
+        max_len = LINE_BUFFER_SIZE;
+    }
+    
+    buf[0] = '\0';
+    
+    while (1) {
+        struct line_state* line = &lines[fb_console_current()];
+
+        event = getkey();
+        
+        if (event == 0) {
+            // 没有可用按键时先做空闲工作（其中会处理已收到的原始输入），
+            // 仍然没有按键就睡眠到下一次输入中断
+            idle_work();
+            if (input_available() == 0) {
+                wait_event_wait(&input_arrived, &input_seen);
+            }
+            continue;
+        }
+
+        // 只处理按下事件
+        if (event & KEYBOARD_EVENT_RELEASED) {
+            continue;
+        }
+        code = KEYBOARD_EVENT_CODE(event);
+
+        if (line->searching && line_search_key(line, code, max_len)) {
+            continue;
+        }
+        
+        switch (code) {
+            case '\n':
+                return take_line(fb_console_current(), buf);
+            case '\b':
+                line_backspace(line);
+                continue;
+            case KEYBOARD_KEY_DELETE:
+                line_delete(line);
+                continue;
+            case LINE_KILL_TO_END:
+                line_kill(line);
+                continue;
+            case KEYBOARD_KEY_LEFT:
+                if (line->pos > 0) {
+                    line_move(line, line->pos - 1);
+                }
+                continue;
+            case KEYBOARD_KEY_RIGHT:
+                line_move(line, line->pos + 1);
+                continue;
+            case KEYBOARD_KEY_HOME:
+                line_move(line, 0);
+                continue;
+            case KEYBOARD_KEY_END:
+                line_move(line, line->len);
+                continue;
+            case KEYBOARD_KEY_UP:
+                line_history_step(line, 1, max_len);
+                continue;
+            case KEYBOARD_KEY_DOWN:
+                line_history_step(line, -1, max_len);
+                continue;
+            case LINE_REVERSE_SEARCH:
+                line_search_start(line);
+                continue;
+
+            // 翻页键：回看滚出屏幕的历史
+            case KEYBOARD_KEY_PAGE_UP:
+                fb_page_up();
+                continue;
+            case KEYBOARD_KEY_PAGE_DOWN:
+                fb_page_down();
+                continue;
+            default:
+                break;
+        }
+
+        // Alt+F1..F4：切换控制台，继续编辑那个控制台上未完成的行
+        if ((KEYBOARD_EVENT_MODIFIERS(event) & KEYBOARD_MOD_ALT) &&
+            code >= KEYBOARD_KEY_F1 && code < KEYBOARD_KEY_F1 + FB_CONSOLE_COUNT) {
+            fb_console_switch(code - KEYBOARD_KEY_F1);
+            continue;
+        }
+
+        // 常规字符（Alt 组合键不作为输入）
+        if (code >= 32 && code <= 126 && !(KEYBOARD_EVENT_MODIFIERS(event) & KEYBOARD_MOD_ALT)) {
+            line_insert(line, (char) code, max_len);
+        }
+    }
+}
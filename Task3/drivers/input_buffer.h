@@ -1,28 +1,64 @@
-#ifndef INCLUDE_INPUT_BUFFER_H
-#define INCLUDE_INPUT_BUFFER_H
-
-#include "types.h"
-
-#define INPUT_BUFFER_SIZE 256  // 缓冲区大小
-#define LINE_BUFFER_SIZE 128   // 行缓冲区大小
-
-// 初始化输入缓冲区系统
-void input_buffer_init(void);
-
-// 向缓冲区添加字符（供中断处理程序使用）
-void buffer_put(u8int c);
-
-// 从缓冲区获取一个字符（非阻塞）
-// 返回：获取的字符，如果缓冲区为空则返回0
-u8int getc(void);
-
-// 读取一行输入
-// buf: 存储输入的缓冲区
-// max_len: 缓冲区最大长度
-// 返回：实际读取的字符数
-u32int readline(char* buf, u32int max_len);
-
-// 检查缓冲区中是否有数据
-u32int input_available(void);
-
+#ifndef INCLUDE_INPUT_BUFFER_H
+#define INCLUDE_INPUT_BUFFER_H
+
+#include "types.h"
+
+#define INPUT_BUFFER_SIZE 256  // 缓冲区大小（按键事件个数，必须是 2 的幂）
+#define LINE_BUFFER_SIZE 128   // 行缓冲区大小
+
+// 初始化输入缓冲区系统
+void input_buffer_init(void);
+
+// 输入来源
+#define INPUT_SOURCE_KEYBOARD 0
+#define INPUT_SOURCE_SERIAL   1
+#define INPUT_SOURCE_OTHER    2
+#define INPUT_SOURCE_COUNT    3
+
+// 输入路径统计（只增不减，high_water 除外）
+struct input_stats {
+    u32int enqueued;                       // 放入缓冲区的事件数
+    u32int dropped;                        // 缓冲区满而丢弃的事件数
+    u32int high_water;                     // 缓冲区中同时存在的最多事件数
+    u32int source_enqueued[INPUT_SOURCE_COUNT];
+    u32int source_dropped[INPUT_SOURCE_COUNT];
+};
+
+// 输入缓冲区是单生产者/单消费者队列：写入方（键盘和串口的下半部）与
+// 读取方（readline）各自只修改自己的下标，不需要关中断。缓冲区满时丢弃新事件
+
+// 向缓冲区添加一个来自 source 的按键事件（KEYBOARD_EVENT 格式）
+void buffer_put_event(u32int source, u32int event);
+
+// 批量添加/取出按键事件，返回实际处理的个数
+u32int buffer_putn(u32int source, const u32int* events, u32int count);
+u32int buffer_getn(u32int* events, u32int count);
+
+// 向缓冲区添加字符，相当于一个无修饰键的按下事件（来源记为 INPUT_SOURCE_OTHER）
+void buffer_put(u8int c);
+
+// 读取输入路径统计
+void input_get_stats(struct input_stats* stats);
+
+// 从缓冲区获取一个按键事件（非阻塞）
+// 返回：获取的事件，如果缓冲区为空则返回0
+u32int getkey(void);
+
+// 从缓冲区获取一个字符（非阻塞）；跳过松开事件和非字符按键
+// 返回：获取的字符，如果缓冲区为空则返回0
+u8int getc(void);
+
+// 读取一行输入
+// buf: 存储输入的缓冲区
+// max_len: 缓冲区最大长度
+// 返回：实际读取的字符数
+u32int readline(char* buf, u32int max_len);
+
+// 通知读取方有新的输入到达（键盘和串口的中断处理程序调用），
+// 阻塞在 readline 中的读取方会被唤醒
+void input_notify(void);
+
+// 检查缓冲区中是否有数据
+u32int input_available(void);
+
 #endif /* INCLUDE_INPUT_BUFFER_H */
\ No newline at end of file
@@ -1,48 +1,75 @@
-;Generic Interrupt Handler
-;
-extern interrupt_handler
-
-%macro no_error_code_interrupt_handler 1
-global interrupt_handler_%1
-interrupt_handler_%1:
-    push dword 0    ; push 0 as error code
-    push dword %1    ; push the interrupt number
-    jmp common_interrupt_handler    ; jump to the common handler
-%endmacro
-
-%macro error_code_interrupt_handler 1
-global interrupt_handler_%1
-interrupt_handler_%1:
-    push dword %1    ; push the interrupt number
-    jmp common_interrupt_handler    ; jump to the common handler
-%endmacro
-
-common_interrupt_handler:    ; the common parts of the generic interrupt handler
-    ; save the registers
-    push eax
-    push ebx
-    push ecx
-    push edx
-    push ebp
-    push esi
-    push edi
-
-    ; call the C function
-    call interrupt_handler
-
-    ; restore the registers
-    pop edi
-    pop esi
-    pop ebp
-    pop edx
-    pop ecx
-    pop ebx
-    pop eax
-
-    ; restore the esp
-    add esp, 8
-
-    ; return to the code that got interrupted
-    iret
-
-no_error_code_interrupt_handler 33 ; create handler for interrupt 33 (keyboard)
\ No newline at end of file
+;Generic Interrupt Handler
+;
+extern interrupt_handler
+
+; Exceptions for which the CPU pushes an error code itself:
+; 8 (double fault), 10-14 (TSS, segment, stack, GP, page fault), 17 (alignment check)
+%define HAS_ERROR_CODE(vector) ((vector) == 8 || ((vector) >= 10 && (vector) <= 14) || (vector) == 17)
+
+common_interrupt_handler:    ; the common parts of the generic interrupt handler
+    ; save the registers; together with the error code, the interrupt number and
+    ; what the CPU pushed they form a struct trap_frame on the stack
+    push eax
+    push ebx
+    push ecx
+    push edx
+    push ebp
+    push esi
+    push edi
+    push ds
+    push es
+    push fs
+    push gs
+
+    ; use the kernel data segment; ss is always the kernel stack segment here
+    mov ax, ss
+    mov ds, ax
+    mov es, ax
+
+    ; call the C function with a pointer to the frame
+    push esp
+    call interrupt_handler
+
+    ; the C function returns the frame to resume, which may belong to
+    ; another task (this also drops the argument pushed above)
+    mov esp, eax
+
+    ; restore the registers
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    pop edi
+    pop esi
+    pop ebp
+    pop edx
+    pop ecx
+    pop ebx
+    pop eax
+
+    ; restore the esp
+    add esp, 8
+
+    ; return to the code that got interrupted
+    iret
+
+; create handlers for all 256 vectors: interrupt_handler_0 .. interrupt_handler_255
+%assign vector 0
+%rep 256
+interrupt_handler_%+vector:
+%if HAS_ERROR_CODE(vector) == 0
+    push dword 0    ; push 0 as error code
+%endif
+    push dword vector    ; push the interrupt number
+    jmp common_interrupt_handler    ; jump to the common handler
+%assign vector vector + 1
+%endrep
+
+; interrupt_stub_table - addresses of the 256 handlers, indexed by vector
+global interrupt_stub_table
+interrupt_stub_table:
+%assign vector 0
+%rep 256
+    dd interrupt_handler_%+vector
+%assign vector vector + 1
+%endrep
\ No newline at end of file
@@ -1,82 +1,192 @@
-#include "interrupts.h"
-#include "pic.h"
-#include "io.h"
-#include "frame_buffer.h"
-#include "keyboard.h"
-#include "input_buffer.h"
-
-#define INTERRUPTS_DESCRIPTOR_COUNT 256
-#define INTERRUPTS_KEYBOARD 33
-
-struct IDTDescriptor idt_descriptors[INTERRUPTS_DESCRIPTOR_COUNT];
-struct IDT idt;
-
-// 内联实现 load_idt
-static void load_idt(u32int idt_address) {
-    __asm__ __volatile__("lidt (%0)" : : "r" (idt_address));
-}
-
-void interrupts_init_descriptor(s32int index, u32int address)
-{
-    idt_descriptors[index].offset_high = (address >> 16) & 0xFFFF;
-    idt_descriptors[index].offset_low = (address & 0xFFFF);
-    idt_descriptors[index].segment_selector = 0x08;
-    idt_descriptors[index].reserved = 0x00;
-    idt_descriptors[index].type_and_attr = 0x8E;
-}
-
-void interrupts_install_idt()
-{
-    // 初始化输入缓冲区
-    input_buffer_init();
-    
-    // 只设置键盘中断
-    interrupts_init_descriptor(INTERRUPTS_KEYBOARD, (u32int) interrupt_handler_33);
-
-    idt.address = (s32int) &idt_descriptors;
-    idt.size = sizeof(struct IDTDescriptor) * INTERRUPTS_DESCRIPTOR_COUNT - 1;
-    load_idt((s32int) &idt);
-
-    // PIC重新映射
-    pic_remap(PIC_1_OFFSET, PIC_2_OFFSET);
-
-    // 只启用键盘中断
-    outb(0x21, 0xFD); // 11111101 - 只启用IRQ1（键盘）
-    outb(0xA1, 0xFF); // 11111111 - 禁用所有从PIC中断
-}
-
-void interrupt_handler(struct cpu_state cpu, u32int interrupt, struct stack_state stack) {
-    (void)cpu;
-    (void)stack;
-    
-    switch (interrupt) {
-        case INTERRUPTS_KEYBOARD: {
-            u8int scan_code;
-            u8int ascii;
-            
-            // 读取扫描码
-            scan_code = inb(0x60);
-            
-            // 只处理按键按下
-            if (!(scan_code & 0x80)) {
-                ascii = keyboard_scan_code_to_ascii(scan_code);
-                
-                if (ascii != 0) {
-                    // 只将字符存入输入缓冲区，不在中断处理程序中显示
-                    buffer_put(ascii);
-                }
-            }
-            
-            // 确认中断
-            pic_acknowledge(interrupt);
-            break;
-        }
-
-        default:
-            // 确认其他可能的中断
-            if (interrupt >= PIC_1_OFFSET && interrupt <= PIC_2_END) {
-                pic_acknowledge(interrupt);
-            }
-            break;
-    }
-}
\ No newline at end of file
+#include "interrupts.h"
+#include "pic.h"
+#include "apic.h"
+#include "io.h"
+#include "frame_buffer.h"
+#include "input_buffer.h"
+#include "klog.h"
+
+struct IDTDescriptor idt_descriptors[INTERRUPTS_DESCRIPTOR_COUNT];
+struct IDT idt;
+
+// 内联实现 load_idt
+static void load_idt(u32int idt_address) {
+    __asm__ __volatile__("lidt (%0)" : : "r" (idt_address));
+}
+
+void interrupts_init_descriptor(s32int index, u32int address)
+{
+    idt_descriptors[index].offset_high = (address >> 16) & 0xFFFF;
+    idt_descriptors[index].offset_low = (address & 0xFFFF);
+    idt_descriptors[index].segment_selector = 0x08;
+    idt_descriptors[index].reserved = 0x00;
+    idt_descriptors[index].type_and_attr = 0x8E;
+}
+
+// 按向量号索引的分发表，分发只需一次查表
+static struct {
+    irq_handler handler;
+    void* context;
+} irq_table[INTERRUPTS_DESCRIPTOR_COUNT];
+
+static u32int irq_unhandled_count = 0;
+
+// 驱动打开的 ISA IRQ 线（第 n 位对应 IRQn）。驱动可能在选定中断控制器之前就打开
+// 自己的 IRQ（例如最先初始化的串口），改用 APIC 后按它重新打开
+static u16int irq_enabled_lines = 0;
+
+// 处理函数请求切换到的现场，0 表示返回被中断的现场
+static struct trap_frame* irq_next_frame = 0;
+
+static const char* exception_names[INTERRUPTS_EXCEPTION_COUNT] = {
+    "Divide error", "Debug", "NMI", "Breakpoint",
+    "Overflow", "BOUND range exceeded", "Invalid opcode", "Device not available",
+    "Double fault", "Coprocessor segment overrun", "Invalid TSS", "Segment not present",
+    "Stack-segment fault", "General protection fault", "Page fault", "Reserved",
+    "x87 floating-point error", "Alignment check", "Machine check", "SIMD floating-point error",
+    "Virtualization exception", "Control protection exception", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Reserved", "Reserved",
+    "Hypervisor injection exception", "VMM communication exception", "Security exception", "Reserved"
+};
+
+void irq_register(u32int vector, irq_handler handler, void* context) {
+    if (vector >= INTERRUPTS_DESCRIPTOR_COUNT) {
+        return;
+    }
+    irq_table[vector].handler = 0;
+    irq_table[vector].context = context;
+    irq_table[vector].handler = handler;
+}
+
+void interrupts_switch_frame(struct trap_frame* next) {
+    irq_next_frame = next;
+}
+
+void irq_unmask(u32int irq) {
+    if (irq < 16) {
+        irq_enabled_lines |= 1 << irq;
+    }
+    if (apic_enabled()) {
+        apic_unmask(irq);
+    } else {
+        pic_unmask(irq);
+    }
+}
+
+void irq_mask(u32int irq) {
+    if (irq < 16) {
+        irq_enabled_lines &= ~(1 << irq);
+    }
+    if (apic_enabled()) {
+        apic_mask(irq);
+    } else {
+        pic_mask(irq);
+    }
+}
+
+u8int interrupts_apic(void) {
+    return apic_enabled();
+}
+
+u32int interrupts_unhandled(void) {
+    return irq_unhandled_count;
+}
+
+void interrupts_install_idt()
+{
+    // 初始化输入缓冲区
+    input_buffer_init();
+    
+    // 全部 256 个向量都指向汇编入口，没有注册的中断也不会三重故障
+    for (s32int i = 0; i < INTERRUPTS_DESCRIPTOR_COUNT; i++) {
+        interrupts_init_descriptor(i, interrupt_stub_table[i]);
+    }
+
+    idt.address = (s32int) &idt_descriptors;
+    idt.size = sizeof(struct IDTDescriptor) * INTERRUPTS_DESCRIPTOR_COUNT - 1;
+    load_idt((s32int) &idt);
+
+    // PIC重新映射（即使改用 APIC，8259 的伪中断也会落在 IRQ 向量上）；
+    // 有 APIC 时改由 I/O APIC 投递。各驱动注册中断时用 irq_unmask 打开自己的 IRQ
+    pic_remap(PIC_1_OFFSET, PIC_2_OFFSET);
+    if (apic_init()) {
+        for (u32int irq = 0; irq < 16; irq++) {
+            if (irq_enabled_lines & (1 << irq)) {
+                apic_unmask(irq);
+            }
+        }
+    }
+}
+
+// 向送来中断的控制器发送 EOI。APIC 只需写一次本地 APIC 的 EOI 寄存器，
+// 伪中断不需要 EOI
+static void interrupts_acknowledge(u32int interrupt) {
+    if (apic_enabled()) {
+        if (interrupt >= PIC_1_OFFSET && interrupt <= APIC_TIMER_VECTOR) {
+            apic_acknowledge();
+        }
+    } else if (interrupt >= PIC_1_OFFSET && interrupt <= PIC_2_END) {
+        pic_acknowledge(interrupt);
+    }
+}
+
+// 输出 8 位十六进制数
+static void interrupts_write_hex32(const char* name, u32int value) {
+    fb_write_string(name);
+    fb_write_string("=0x");
+    for (s32int shift = 24; shift >= 0; shift -= 8) {
+        fb_write_hex((u8int) (value >> shift));
+    }
+    fb_write_string("  ");
+}
+
+// 没有处理函数的 CPU 异常：报告后停机（返回会再次执行出错的指令）
+static void interrupts_report_exception(struct trap_frame* frame) {
+    klog(KLOG_ERROR, exception_names[frame->interrupt]);
+
+    fb_write_string("\n*** CPU exception ");
+    fb_write_dec(frame->interrupt);
+    fb_write_string(": ");
+    fb_write_string(exception_names[frame->interrupt]);
+    fb_write_string(" ***\n");
+    interrupts_write_hex32("err", frame->error_code);
+    interrupts_write_hex32("eip", frame->eip);
+    interrupts_write_hex32("cs", frame->cs);
+    interrupts_write_hex32("eflags", frame->eflags);
+    fb_write_string("\n");
+    interrupts_write_hex32("eax", frame->eax);
+    interrupts_write_hex32("ebx", frame->ebx);
+    interrupts_write_hex32("ecx", frame->ecx);
+    interrupts_write_hex32("edx", frame->edx);
+    fb_write_string("\n");
+    interrupts_write_hex32("esi", frame->esi);
+    interrupts_write_hex32("edi", frame->edi);
+    interrupts_write_hex32("ebp", frame->ebp);
+    interrupts_write_hex32("ds", frame->ds);
+    fb_write_string("\nSystem halted.\n");
+    fb_flush();
+
+    while (1) {
+        __asm__ __volatile__("cli; hlt");
+    }
+}
+
+struct trap_frame* interrupt_handler(struct trap_frame* frame) {
+    u32int interrupt = frame->interrupt & (INTERRUPTS_DESCRIPTOR_COUNT - 1);
+    struct trap_frame* next;
+
+    if (irq_table[interrupt].handler != 0) {
+        irq_table[interrupt].handler(frame, irq_table[interrupt].context);
+    } else if (interrupt < INTERRUPTS_EXCEPTION_COUNT) {
+        interrupts_report_exception(frame);
+    } else {
+        irq_unhandled_count++;
+    }
+
+    interrupts_acknowledge(interrupt);
+
+    // 没有请求切换时回到被中断的现场
+    next = irq_next_frame != 0 ? irq_next_frame : frame;
+    irq_next_frame = 0;
+    return next;
+}
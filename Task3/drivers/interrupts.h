@@ -1,43 +1,84 @@
-#ifndef INCLUDE_INTERRUPTS
-#define INCLUDE_INTERRUPTS
-
-#include "types.h"
-
-struct IDT
-{
-    u16int size;
-    u32int address;
-} __attribute__((packed));
-
-struct IDTDescriptor {
-    u16int offset_low;
-    u16int segment_selector;
-    u8int reserved;
-    u8int type_and_attr;
-    u16int offset_high;
-} __attribute__((packed));
-
-struct cpu_state {
-    u32int eax;
-    u32int ebx;
-    u32int ecx;
-    u32int edx;
-    u32int ebp;
-    u32int esi;
-    u32int edi;
-} __attribute__((packed));
-
-struct stack_state {
-    u32int error_code;
-    u32int eip;
-    u32int cs;
-    u32int eflags;
-} __attribute__((packed));
-
-void interrupt_handler(struct cpu_state cpu, u32int interrupt, struct stack_state stack);
-void interrupts_install_idt();
-
-// Wrappers around ASM.
-void interrupt_handler_33();
-
+#ifndef INCLUDE_INTERRUPTS
+#define INCLUDE_INTERRUPTS
+
+#include "types.h"
+
+struct IDT
+{
+    u16int size;
+    u32int address;
+} __attribute__((packed));
+
+struct IDTDescriptor {
+    u16int offset_low;
+    u16int segment_selector;
+    u8int reserved;
+    u8int type_and_attr;
+    u16int offset_high;
+} __attribute__((packed));
+
+// 中断入口保存在栈上的完整现场，按地址从低到高排列。
+// 汇编入口把指向它的指针交给 interrupt_handler，处理函数可以直接读写
+struct trap_frame {
+    // 段寄存器（每个占 4 字节）
+    u32int gs;
+    u32int fs;
+    u32int es;
+    u32int ds;
+
+    // 通用寄存器
+    u32int edi;
+    u32int esi;
+    u32int ebp;
+    u32int edx;
+    u32int ecx;
+    u32int ebx;
+    u32int eax;
+
+    // 汇编入口压入的向量号和错误码（没有错误码的异常为 0）
+    u32int interrupt;
+    u32int error_code;
+
+    // CPU 压入的返回现场
+    u32int eip;
+    u32int cs;
+    u32int eflags;
+
+    // 只有从低特权级进入时 CPU 才会压入
+    u32int user_esp;
+    u32int user_ss;
+} __attribute__((packed));
+
+#define INTERRUPTS_DESCRIPTOR_COUNT 256
+#define INTERRUPTS_EXCEPTION_COUNT  32   // 0-31 为 CPU 异常
+
+// 中断处理函数：frame 为被中断时的现场（向量号为 frame->interrupt），
+// context 为注册时传入的参数
+typedef void (*irq_handler)(struct trap_frame* frame, void* context);
+
+// 由汇编入口调用，返回中断返回时要恢复的现场
+struct trap_frame* interrupt_handler(struct trap_frame* frame);
+void interrupts_install_idt();
+
+// 在处理函数中调用：本次中断返回时恢复 next 而不是被中断的现场（任务切换用）。
+// next 必须是之前某次中断保存在另一个内核栈上的完整现场
+void interrupts_switch_frame(struct trap_frame* next);
+
+// 为向量 vector 注册处理函数（替换原有的）；handler 为 0 表示取消注册。
+// 来自中断控制器的中断在处理函数返回后由分发程序统一发送 EOI
+void irq_register(u32int vector, irq_handler handler, void* context);
+
+// 打开/屏蔽一条 ISA IRQ 线（0-15），经 I/O APIC 或 8259（检测不到 APIC 时）
+void irq_unmask(u32int irq);
+void irq_mask(u32int irq);
+
+// 是否使用 APIC（否则为 8259）
+u8int interrupts_apic(void);
+
+// 没有注册处理函数的中断次数
+u32int interrupts_unhandled(void);
+
+// Wrappers around ASM: interrupt_handler_0 .. interrupt_handler_255
+extern u32int interrupt_stub_table[INTERRUPTS_DESCRIPTOR_COUNT];
+
 #endif /* INCLUDE_INTERRUPTS */
\ No newline at end of file
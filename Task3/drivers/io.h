@@ -1,7 +1,7 @@
-#ifndef INCLUDE_IO_H
-#define INCLUDE_IO_H
-
-unsigned char inb(unsigned short port);
-void outb(unsigned short port, unsigned char data);
-
+#ifndef INCLUDE_IO_H
+#define INCLUDE_IO_H
+
+unsigned char inb(unsigned short port);
+void outb(unsigned short port, unsigned char data);
+
 #endif /* INCLUDE_IO_H */
\ No newline at end of file
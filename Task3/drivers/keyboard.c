@@ -1,79 +1,456 @@
-#include "io.h"
-#include "frame_buffer.h"
-
-#define KEYBOARD_DATA_PORT 0x60
-
-u8int keyboard_read_scan_code(void) {
-    return inb(KEYBOARD_DATA_PORT);
-}
-
-u8int keyboard_scan_code_to_ascii(u8int scan_code) {
-    // 忽略按键释放
-    if (scan_code & 0x80) {
-        return 0;
-    }
-
-    // 完整的US QWERTY键盘映射
-    switch(scan_code) {
-        // 数字行
-        case 0x02: return '1';
-        case 0x03: return '2';
-        case 0x04: return '3';
-        case 0x05: return '4';
-        case 0x06: return '5';
-        case 0x07: return '6';
-        case 0x08: return '7';
-        case 0x09: return '8';
-        case 0x0A: return '9';
-        case 0x0B: return '0';
-        case 0x0C: return '-';
-        case 0x0D: return '=';
-        case 0x0E: return '\b'; // 退格键
-
-        // 顶部字母行
-        case 0x10: return 'q';
-        case 0x11: return 'w';
-        case 0x12: return 'e';
-        case 0x13: return 'r';
-        case 0x14: return 't';
-        case 0x15: return 'y';
-        case 0x16: return 'u';
-        case 0x17: return 'i';
-        case 0x18: return 'o';
-        case 0x19: return 'p';
-        case 0x1A: return '[';
-        case 0x1B: return ']';
-        case 0x1C: return '\n'; // 回车键
-
-        // 中间字母行
-        case 0x1E: return 'a';
-        case 0x1F: return 's';
-        case 0x20: return 'd';
-        case 0x21: return 'f';
-        case 0x22: return 'g';
-        case 0x23: return 'h';
-        case 0x24: return 'j';
-        case 0x25: return 'k';
-        case 0x26: return 'l';
-        case 0x27: return ';';
-        case 0x28: return '\'';
-        case 0x29: return '`';
-
-        // 底部字母行
-        case 0x2B: return '\\';
-        case 0x2C: return 'z';
-        case 0x2D: return 'x';
-        case 0x2E: return 'c';
-        case 0x2F: return 'v';
-        case 0x30: return 'b';
-        case 0x31: return 'n';
-        case 0x32: return 'm';
-        case 0x33: return ',';
-        case 0x34: return '.';
-        case 0x35: return '/';
-        case 0x39: return ' ';  // 空格键
-        
-        default: 
-            return 0; // 未知键
-    }
-}
\ No newline at end of file
+#include "io.h"
+#include "hardware_interrupt_enabler.h"
+#include "frame_buffer.h"
+#include "keyboard.h"
+#include "input_buffer.h"
+#include "klog.h"
+#include "interrupts.h"
+#include "pic.h"
+
+#define KEYBOARD_DATA_PORT 0x60
+#define KEYBOARD_STATUS_PORT 0x64
+
+/* Status register bits */
+#define KEYBOARD_STATUS_OUTPUT_FULL 0x01   // 0x60 中有待读字节
+#define KEYBOARD_STATUS_INPUT_FULL  0x02   // 控制器还没取走上一次写入的字节
+#define KEYBOARD_STATUS_AUX_DATA    0x20   // 待读字节来自鼠标口
+
+/* Keyboard command responses */
+#define KEYBOARD_RESPONSE_ACK    0xFA
+#define KEYBOARD_RESPONSE_RESEND 0xFE
+
+/* Keyboard commands */
+#define KEYBOARD_COMMAND_SET_LEDS      0xED
+#define KEYBOARD_COMMAND_SET_TYPEMATIC 0xF3
+
+// 轮询状态口的次数上限：每次 inb 在 ISA 总线上约 1 微秒，约等于 100 毫秒
+#define KEYBOARD_TIMEOUT_POLLS  100000
+#define KEYBOARD_COMMAND_RETRIES 3
+
+/* Controller error codes */
+#define KEYBOARD_ERROR_DETECTION 0x00
+#define KEYBOARD_ERROR_OVERRUN   0xFF
+
+// 一次中断最多读取的字节数，防止状态位异常时卡死在中断中
+#define KEYBOARD_MAX_BYTES_PER_IRQ 32
+
+#define KEYBOARD_EXTENDED_PREFIX 0xE0
+#define KEYBOARD_RELEASE         0x80
+
+/* Modifier scan codes */
+#define KEYBOARD_LEFT_SHIFT      0x2A
+#define KEYBOARD_RIGHT_SHIFT     0x36
+#define KEYBOARD_CTRL            0x1D   // 右 Ctrl 带 0xE0 前缀
+#define KEYBOARD_ALT             0x38   // 右 Alt 带 0xE0 前缀
+#define KEYBOARD_CAPS_LOCK       0x3A
+
+#define KEYBOARD_F1              0x3B
+#define KEYBOARD_F10             0x44
+#define KEYBOARD_F11             0x57
+#define KEYBOARD_F12             0x58
+
+#define KEYBOARD_TABLE_SIZE      128
+
+// US QWERTY 键位：KEY(扫描码, 普通, Shift)，LETTER(扫描码, 小写字母)。
+// 字母受 CapsLock 影响，其余按键只受 Shift 影响
+#define KEYBOARD_KEYS(KEY, LETTER) \
+    KEY(0x01, 0x1B, 0x1B)   /* Esc */ \
+    KEY(0x02, '1', '!')  KEY(0x03, '2', '@')  KEY(0x04, '3', '#') \
+    KEY(0x05, '4', '$')  KEY(0x06, '5', '%')  KEY(0x07, '6', '^') \
+    KEY(0x08, '7', '&')  KEY(0x09, '8', '*')  KEY(0x0A, '9', '(') \
+    KEY(0x0B, '0', ')')  KEY(0x0C, '-', '_')  KEY(0x0D, '=', '+') \
+    KEY(0x0E, '\b', '\b')   /* 退格键 */ \
+    KEY(0x0F, '\t', '\t')   /* Tab */ \
+    LETTER(0x10, 'q') LETTER(0x11, 'w') LETTER(0x12, 'e') LETTER(0x13, 'r') \
+    LETTER(0x14, 't') LETTER(0x15, 'y') LETTER(0x16, 'u') LETTER(0x17, 'i') \
+    LETTER(0x18, 'o') LETTER(0x19, 'p') \
+    KEY(0x1A, '[', '{')  KEY(0x1B, ']', '}') \
+    KEY(0x1C, '\n', '\n')   /* 回车键 */ \
+    LETTER(0x1E, 'a') LETTER(0x1F, 's') LETTER(0x20, 'd') LETTER(0x21, 'f') \
+    LETTER(0x22, 'g') LETTER(0x23, 'h') LETTER(0x24, 'j') LETTER(0x25, 'k') \
+    LETTER(0x26, 'l') \
+    KEY(0x27, ';', ':')  KEY(0x28, '\'', '"') KEY(0x29, '`', '~') \
+    KEY(0x2B, '\\', '|') \
+    LETTER(0x2C, 'z') LETTER(0x2D, 'x') LETTER(0x2E, 'c') LETTER(0x2F, 'v') \
+    LETTER(0x30, 'b') LETTER(0x31, 'n') LETTER(0x32, 'm') \
+    KEY(0x33, ',', '<')  KEY(0x34, '.', '>')  KEY(0x35, '/', '?') \
+    KEY(0x37, '*', '*')     /* 小键盘 * */ \
+    KEY(0x39, ' ', ' ')     /* 空格键 */ \
+    KEY(0x4A, '-', '-')     /* 小键盘 - */ \
+    KEY(0x4E, '+', '+')     /* 小键盘 + */
+
+// 由上面的键位表在编译期生成各修饰层的 128 项查找表
+#define KEYBOARD_NORMAL(code, normal, shifted)  [code] = normal,
+#define KEYBOARD_SHIFTED(code, normal, shifted) [code] = shifted,
+#define KEYBOARD_NONE(code, normal, shifted)
+#define KEYBOARD_LOWER(code, letter)            [code] = letter,
+#define KEYBOARD_UPPER(code, letter)            [code] = letter - 'a' + 'A',
+#define KEYBOARD_CONTROL(code, letter)          [code] = letter & 0x1F,
+
+static const u8int keymap_normal[KEYBOARD_TABLE_SIZE] = {
+    KEYBOARD_KEYS(KEYBOARD_NORMAL, KEYBOARD_LOWER)
+};
+
+static const u8int keymap_shift[KEYBOARD_TABLE_SIZE] = {
+    KEYBOARD_KEYS(KEYBOARD_SHIFTED, KEYBOARD_UPPER)
+};
+
+static const u8int keymap_caps[KEYBOARD_TABLE_SIZE] = {
+    KEYBOARD_KEYS(KEYBOARD_NORMAL, KEYBOARD_UPPER)
+};
+
+static const u8int keymap_caps_shift[KEYBOARD_TABLE_SIZE] = {
+    KEYBOARD_KEYS(KEYBOARD_SHIFTED, KEYBOARD_LOWER)
+};
+
+// Ctrl 层：Ctrl+字母产生控制字符（Ctrl+C = 0x03 等），其余按键不产生字符
+static const u8int keymap_ctrl[KEYBOARD_TABLE_SIZE] = {
+    KEYBOARD_KEYS(KEYBOARD_NONE, KEYBOARD_CONTROL)
+};
+
+// 按 Shift/CapsLock 组合索引的查找表
+static const u8int* const keymaps[4] = {
+    keymap_normal, keymap_shift, keymap_caps, keymap_caps_shift
+};
+
+// 上一个字节是否为 0xE0 扩展前缀
+static u8int extended = 0;
+
+// 修饰键状态（KEYBOARD_MOD_*）；左右 Shift/Ctrl/Alt 分开记录，任一侧按下即算按下
+static u8int modifiers = 0;
+static u8int modifier_keys = 0;
+
+// modifier_keys 中每个按键的位
+#define KEYBOARD_HELD_LEFT_SHIFT  0x01
+#define KEYBOARD_HELD_RIGHT_SHIFT 0x02
+#define KEYBOARD_HELD_LEFT_CTRL   0x04
+#define KEYBOARD_HELD_RIGHT_CTRL  0x08
+#define KEYBOARD_HELD_LEFT_ALT    0x10
+#define KEYBOARD_HELD_RIGHT_ALT   0x20
+
+// 是否允许连发；关闭时用按键按下状态表过滤重复的按下事件
+static u8int repeat_enabled = 1;
+
+// 每个按键（扫描码 + 是否扩展）是否处于按下状态，一位一个键
+static u32int keys_down[256 / 32];
+
+u8int keyboard_read_scan_code(void) {
+    return inb(KEYBOARD_DATA_PORT);
+}
+
+#define KEYBOARD_RAW_MASK (KEYBOARD_RAW_BUFFER_SIZE - 1)
+
+#define keyboard_barrier() __asm__ __volatile__("" : : : "memory")
+
+// 原始扫描码环：head 只由中断处理程序推进，tail 只由下半部推进
+static struct {
+    u8int buffer[KEYBOARD_RAW_BUFFER_SIZE];
+    volatile u32int head;
+    volatile u32int tail;
+} keyboard_raw;
+
+static struct keyboard_stats keyboard_counters;
+
+// 命令进行中时为 1：IRQ1 上半部不读数据口，ACK/RESEND 和期间的扫描码都由命令层读取
+static volatile u8int keyboard_commanding = 0;
+
+// 把一个字节放入原始环，环满时丢弃。由中断处理程序调用；命令进行中
+// 由命令层调用（此时中断处理程序不写入），因此两者不会同时写入
+static void keyboard_raw_put(u8int scan_code) {
+    if (keyboard_raw.head - keyboard_raw.tail >= KEYBOARD_RAW_BUFFER_SIZE) {
+        keyboard_counters.dropped++;
+        return;
+    }
+    keyboard_raw.buffer[keyboard_raw.head & KEYBOARD_RAW_MASK] = scan_code;
+    keyboard_barrier();
+    keyboard_raw.head++;
+}
+
+// 读出控制器中所有待读的扫描码放入原始环，不做翻译
+static void keyboard_drain_controller(void) {
+    u32int count = 0;
+
+    // 连发或快速输入时控制器里可能已经攒了多个字节，一直读到输出缓冲区为空
+    while (count < KEYBOARD_MAX_BYTES_PER_IRQ) {
+        u8int status = inb(KEYBOARD_STATUS_PORT);
+        u8int scan_code;
+
+        if (!(status & KEYBOARD_STATUS_OUTPUT_FULL)) {
+            break;
+        }
+        scan_code = keyboard_read_scan_code();
+        count++;
+
+        if (status & KEYBOARD_STATUS_AUX_DATA) {
+            continue;  // 鼠标数据，键盘驱动不处理
+        }
+        keyboard_counters.bytes++;
+
+        if (scan_code == KEYBOARD_ERROR_DETECTION || scan_code == KEYBOARD_ERROR_OVERRUN) {
+            keyboard_counters.overruns++;
+            klog(KLOG_WARN, "keyboard controller overrun");
+            continue;
+        }
+
+        keyboard_raw_put(scan_code);
+    }
+    input_notify();
+}
+
+// IRQ1 上半部
+static void keyboard_handle_interrupt(struct trap_frame* frame, void* context) {
+    (void)frame;
+    (void)context;
+
+    keyboard_counters.interrupts++;
+    if (!keyboard_commanding) {
+        keyboard_drain_controller();
+    }
+}
+
+// 等待控制器可以接收下一个字节后写入数据口
+static s32int keyboard_write(u8int value) {
+    for (u32int i = 0; i < KEYBOARD_TIMEOUT_POLLS; i++) {
+        if (!(inb(KEYBOARD_STATUS_PORT) & KEYBOARD_STATUS_INPUT_FULL)) {
+            outb(KEYBOARD_DATA_PORT, value);
+            return KEYBOARD_COMMAND_OK;
+        }
+    }
+    return KEYBOARD_COMMAND_TIMEOUT;
+}
+
+// 等待键盘对一个字节的回复；期间收到的普通扫描码放入原始环
+static s32int keyboard_wait_response(void) {
+    for (u32int i = 0; i < KEYBOARD_TIMEOUT_POLLS; i++) {
+        u8int status = inb(KEYBOARD_STATUS_PORT);
+        u8int value;
+
+        if (!(status & KEYBOARD_STATUS_OUTPUT_FULL)) {
+            continue;
+        }
+        value = keyboard_read_scan_code();
+        if (status & KEYBOARD_STATUS_AUX_DATA) {
+            continue;
+        }
+        if (value == KEYBOARD_RESPONSE_ACK || value == KEYBOARD_RESPONSE_RESEND) {
+            return value;
+        }
+        keyboard_raw_put(value);
+    }
+    return KEYBOARD_COMMAND_TIMEOUT;
+}
+
+// 发送一个字节并等待 ACK，收到 RESEND 时重发
+static s32int keyboard_send(u8int value) {
+    for (u32int attempt = 0; attempt < KEYBOARD_COMMAND_RETRIES; attempt++) {
+        s32int response;
+
+        if (keyboard_write(value) != KEYBOARD_COMMAND_OK) {
+            return KEYBOARD_COMMAND_TIMEOUT;
+        }
+        response = keyboard_wait_response();
+        if (response == KEYBOARD_RESPONSE_ACK) {
+            return KEYBOARD_COMMAND_OK;
+        }
+        if (response != KEYBOARD_RESPONSE_RESEND) {
+            return KEYBOARD_COMMAND_TIMEOUT;
+        }
+    }
+    return KEYBOARD_COMMAND_REJECTED;
+}
+
+s32int keyboard_command(u8int command, u8int has_data, u8int data) {
+    u32int flags;
+    s32int result;
+
+    // 开中断轮询，时钟和串口照常工作；IRQ1 在此期间不读数据口，不会把 ACK 当成扫描码取走
+    keyboard_commanding = 1;
+    result = keyboard_send(command);
+    if (result == KEYBOARD_COMMAND_OK && has_data) {
+        result = keyboard_send(data);
+    }
+
+    // 命令结束前到达的字节不会再触发 IRQ1（输出缓冲区一直是满的），在这里读走
+    flags = save_and_disable_hardware_interrupts();
+    keyboard_commanding = 0;
+    keyboard_drain_controller();
+    restore_hardware_interrupts(flags);
+
+    if (result != KEYBOARD_COMMAND_OK) {
+        klog(KLOG_WARN, result == KEYBOARD_COMMAND_TIMEOUT ? "keyboard command timed out"
+                                                           : "keyboard command rejected");
+    }
+    return result;
+}
+
+s32int keyboard_set_typematic(u8int rate, u8int delay) {
+    if (rate > KEYBOARD_TYPEMATIC_RATE_MAX) {
+        rate = KEYBOARD_TYPEMATIC_RATE_MAX;
+    }
+    if (delay > KEYBOARD_TYPEMATIC_DELAY_MAX) {
+        delay = KEYBOARD_TYPEMATIC_DELAY_MAX;
+    }
+    return keyboard_command(KEYBOARD_COMMAND_SET_TYPEMATIC, 1, (u8int) ((delay << 5) | rate));
+}
+
+s32int keyboard_set_leds(u8int leds) {
+    return keyboard_command(KEYBOARD_COMMAND_SET_LEDS, 1,
+                            leds & (KEYBOARD_LED_SCROLL_LOCK | KEYBOARD_LED_NUM_LOCK | KEYBOARD_LED_CAPS_LOCK));
+}
+
+void keyboard_set_repeat(u8int enabled) {
+    repeat_enabled = enabled ? 1 : 0;
+}
+
+u8int keyboard_repeat_enabled(void) {
+    return repeat_enabled;
+}
+
+void keyboard_init(void) {
+    irq_register(PIC_1_OFFSET + KEYBOARD_IRQ, keyboard_handle_interrupt, 0);
+    irq_unmask(KEYBOARD_IRQ);
+}
+
+void keyboard_get_stats(struct keyboard_stats* stats) {
+    *stats = keyboard_counters;
+}
+
+u8int keyboard_modifiers(void) {
+    return modifiers;
+}
+
+// 记录一侧修饰键的按下/松开；两侧（both）都松开后才清除修饰位
+static void keyboard_update_side(u8int bit, u8int both, u8int modifier, u8int released) {
+    modifier_keys = released ? (modifier_keys & ~bit) : (modifier_keys | bit);
+    modifiers = (modifier_keys & both) ? (modifiers | modifier) : (modifiers & ~modifier);
+}
+
+// 修饰键的按下/松开；是修饰键时返回 1
+static u8int keyboard_update_modifiers(u8int scan_code, u8int is_extended) {
+    u8int released = scan_code & KEYBOARD_RELEASE;
+    u8int key = scan_code & ~KEYBOARD_RELEASE;
+
+    switch (key) {
+        case KEYBOARD_LEFT_SHIFT:
+        case KEYBOARD_RIGHT_SHIFT:
+            // 0xE0 2A / 0xE0 AA 是部分按键附带的假 Shift，忽略
+            if (is_extended) {
+                return 1;
+            }
+            keyboard_update_side(key == KEYBOARD_RIGHT_SHIFT ? KEYBOARD_HELD_RIGHT_SHIFT : KEYBOARD_HELD_LEFT_SHIFT,
+                                 KEYBOARD_HELD_LEFT_SHIFT | KEYBOARD_HELD_RIGHT_SHIFT, KEYBOARD_MOD_SHIFT, released);
+            return 1;
+        case KEYBOARD_CTRL:
+            keyboard_update_side(is_extended ? KEYBOARD_HELD_RIGHT_CTRL : KEYBOARD_HELD_LEFT_CTRL,
+                                 KEYBOARD_HELD_LEFT_CTRL | KEYBOARD_HELD_RIGHT_CTRL, KEYBOARD_MOD_CTRL, released);
+            return 1;
+        case KEYBOARD_ALT:
+            keyboard_update_side(is_extended ? KEYBOARD_HELD_RIGHT_ALT : KEYBOARD_HELD_LEFT_ALT,
+                                 KEYBOARD_HELD_LEFT_ALT | KEYBOARD_HELD_RIGHT_ALT, KEYBOARD_MOD_ALT, released);
+            return 1;
+        case KEYBOARD_CAPS_LOCK:
+            // CapsLock 在按下时切换，松开不影响
+            if (!is_extended && !released) {
+                modifiers ^= KEYBOARD_MOD_CAPS_LOCK;
+            }
+            return !is_extended;
+        default:
+            return 0;
+    }
+}
+
+// 0xE0 开头的扩展键
+static u32int keyboard_extended_code(u8int key) {
+    switch (key) {
+        case 0x48: return KEYBOARD_KEY_UP;
+        case 0x50: return KEYBOARD_KEY_DOWN;
+        case 0x4B: return KEYBOARD_KEY_LEFT;
+        case 0x4D: return KEYBOARD_KEY_RIGHT;
+        case 0x47: return KEYBOARD_KEY_HOME;
+        case 0x4F: return KEYBOARD_KEY_END;
+        case 0x49: return KEYBOARD_KEY_PAGE_UP;
+        case 0x51: return KEYBOARD_KEY_PAGE_DOWN;
+        case 0x52: return KEYBOARD_KEY_INSERT;
+        case 0x53: return KEYBOARD_KEY_DELETE;
+        case 0x1C: return '\n';  // 小键盘回车
+        case 0x35: return '/';   // 小键盘 /
+        default:   return 0;
+    }
+}
+
+// 普通（无前缀）按键
+static u32int keyboard_code(u8int key) {
+    // 功能键 F1..F10, F11, F12
+    if (key >= KEYBOARD_F1 && key <= KEYBOARD_F10) {
+        return KEYBOARD_KEY_F1 + (key - KEYBOARD_F1);
+    }
+    if (key == KEYBOARD_F11 || key == KEYBOARD_F12) {
+        return KEYBOARD_KEY_F1 + 10 + (key - KEYBOARD_F11);
+    }
+
+    // Ctrl+字母产生控制字符，其余按键在 Ctrl 下保留原字符，由使用者结合修饰位判断
+    if ((modifiers & KEYBOARD_MOD_CTRL) && keymap_ctrl[key] != 0) {
+        return keymap_ctrl[key];
+    }
+    return keymaps[((modifiers & KEYBOARD_MOD_CAPS_LOCK) ? 2 : 0) +
+                   ((modifiers & KEYBOARD_MOD_SHIFT) ? 1 : 0)][key];
+}
+
+u32int keyboard_scan_code_to_event(u8int scan_code) {
+    u8int is_extended = extended;
+    u8int key = scan_code & ~KEYBOARD_RELEASE;
+    u32int code;
+
+    // 扩展键以 0xE0 开头，记下前缀等待下一个字节
+    if (scan_code == KEYBOARD_EXTENDED_PREFIX) {
+        extended = 1;
+        return 0;
+    }
+    extended = 0;
+
+    if (keyboard_update_modifiers(scan_code, is_extended)) {
+        return 0;
+    }
+
+    // 连发关闭时，已经按下的键再次收到按下扫描码就是连发，丢弃
+    u32int index = key | (is_extended ? 0x80 : 0);
+    u32int bit = 1u << (index & 31);
+    if (scan_code & KEYBOARD_RELEASE) {
+        keys_down[index >> 5] &= ~bit;
+    } else {
+        if (!repeat_enabled && (keys_down[index >> 5] & bit)) {
+            return 0;
+        }
+        keys_down[index >> 5] |= bit;
+    }
+
+    code = is_extended ? keyboard_extended_code(key) : keyboard_code(key);
+    if (code == 0) {
+        return 0;
+    }
+    return KEYBOARD_EVENT(code, modifiers, scan_code & KEYBOARD_RELEASE);
+}
+
+u8int keyboard_scan_code_to_ascii(u8int scan_code) {
+    u32int event = keyboard_scan_code_to_event(scan_code);
+    u32int code = KEYBOARD_EVENT_CODE(event);
+
+    if (event == 0 || (event & KEYBOARD_EVENT_RELEASED) || code >= 0x80) {
+        return 0;
+    }
+    return (u8int) code;
+}
+
+void keyboard_process(void) {
+    while (keyboard_raw.tail != keyboard_raw.head) {
+        keyboard_barrier();
+        u8int scan_code = keyboard_raw.buffer[keyboard_raw.tail & KEYBOARD_RAW_MASK];
+        u32int event;
+
+        keyboard_raw.tail++;
+        event = keyboard_scan_code_to_event(scan_code);
+        if (event != 0) {
+            buffer_put_event(INPUT_SOURCE_KEYBOARD, event);
+        }
+    }
+}
@@ -1,11 +1,96 @@
-#ifndef INCLUDE_KEYBOARD_H
-#define INCLUDE_KEYBOARD_H
-
-#define KEYBOARD_MAX_ASCII 83
-
-#include "types.h"
-
-u8int keyboard_read_scan_code(void);
-u8int keyboard_scan_code_to_ascii(u8int);
-
+#ifndef INCLUDE_KEYBOARD_H
+#define INCLUDE_KEYBOARD_H
+
+#define KEYBOARD_MAX_ASCII 83
+
+#include "types.h"
+
+// 32 位按键事件：
+//   位 0-15  键码：0x01-0x7F 为 ASCII 字符，0x100 以上为下面的特殊键
+//   位 16-23 事件发生时的修饰键状态（KEYBOARD_MOD_*）
+//   位 24    1 = 松开，0 = 按下
+#define KEYBOARD_EVENT(code, mods, released) \
+    ((u32int) (code) | ((u32int) (mods) << 16) | ((released) ? KEYBOARD_EVENT_RELEASED : 0))
+#define KEYBOARD_EVENT_RELEASED      0x01000000
+#define KEYBOARD_EVENT_CODE(event)      ((event) & 0xFFFF)
+#define KEYBOARD_EVENT_MODIFIERS(event) (((event) >> 16) & 0xFF)
+
+// 特殊键的键码
+#define KEYBOARD_KEY_UP        0x100
+#define KEYBOARD_KEY_DOWN      0x101
+#define KEYBOARD_KEY_LEFT      0x102
+#define KEYBOARD_KEY_RIGHT     0x103
+#define KEYBOARD_KEY_HOME      0x104
+#define KEYBOARD_KEY_END       0x105
+#define KEYBOARD_KEY_PAGE_UP   0x106
+#define KEYBOARD_KEY_PAGE_DOWN 0x107
+#define KEYBOARD_KEY_INSERT    0x108
+#define KEYBOARD_KEY_DELETE    0x109
+#define KEYBOARD_KEY_F1        0x110  // F2..F12 依次加 1
+
+// 修饰键状态位
+#define KEYBOARD_MOD_SHIFT     0x01
+#define KEYBOARD_MOD_CTRL      0x02
+#define KEYBOARD_MOD_ALT       0x04
+#define KEYBOARD_MOD_CAPS_LOCK 0x08
+
+#define KEYBOARD_RAW_BUFFER_SIZE 64  // 原始扫描码环大小（2 的幂）
+
+// 键盘驱动统计（只增不减）
+struct keyboard_stats {
+    u32int interrupts;  // IRQ1 次数
+    u32int bytes;       // 从 0x60 读出的字节数
+    u32int overruns;    // 控制器报告的溢出/错误码（0x00、0xFF）个数
+    u32int dropped;     // 原始环已满而丢弃的字节数
+};
+
+// 8042/PS2 命令的返回值
+#define KEYBOARD_COMMAND_OK       0
+#define KEYBOARD_COMMAND_TIMEOUT  -1  // 控制器或键盘没有响应
+#define KEYBOARD_COMMAND_REJECTED -2  // 重发多次后键盘仍回复 RESEND
+
+// LED 位（0xED 命令的参数）
+#define KEYBOARD_LED_SCROLL_LOCK 0x01
+#define KEYBOARD_LED_NUM_LOCK    0x02
+#define KEYBOARD_LED_CAPS_LOCK   0x04
+
+// 连发参数范围：rate 0 = 30 次/秒 .. 31 = 2 次/秒；delay 0..3 = 250/500/750/1000 毫秒
+#define KEYBOARD_TYPEMATIC_RATE_MAX  31
+#define KEYBOARD_TYPEMATIC_DELAY_MAX 3
+
+#define KEYBOARD_IRQ 1
+
+// 注册 IRQ1 处理函数并打开键盘中断
+void keyboard_init(void);
+
+u8int keyboard_read_scan_code(void);
+
+// 向键盘发送一条命令（可带一个参数字节），等待 ACK，收到 RESEND 时重发。
+// 开中断轮询完成（期间 IRQ1 不读数据口）；等待期间收到的扫描码照常放入原始环
+s32int keyboard_command(u8int command, u8int has_data, u8int data);
+
+// 设置连发速率和延迟（0xF3）
+s32int keyboard_set_typematic(u8int rate, u8int delay);
+
+// 设置键盘指示灯（0xED），leds 为 KEYBOARD_LED_* 的组合
+s32int keyboard_set_leds(u8int leds);
+
+// 打开/关闭连发：扫描码集 1 无法在硬件上关闭连发，关闭时由驱动丢弃重复的按下事件
+void keyboard_set_repeat(u8int enabled);
+u8int keyboard_repeat_enabled(void);
+
+// 读取统计计数
+void keyboard_get_stats(struct keyboard_stats* stats);
+
+// 下半部：翻译原始环中的扫描码并把按键事件放入输入缓冲区（在空闲循环中调用）
+void keyboard_process(void);
+
+// 把扫描码（包括 0xE0 开头的多字节序列）翻译成按键事件。
+// 序列未结束、修饰键或未知按键返回 0
+u32int keyboard_scan_code_to_event(u8int scan_code);
+
+// 只关心字符的简化接口：按下可打印/控制字符时返回它，其余返回 0
+u8int keyboard_scan_code_to_ascii(u8int);
+u8int keyboard_modifiers(void);
+
 #endif /* INCLUDE_KEYBOARD_H */
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "klog.h"
+#include "frame_buffer.h"
+#include "serial.h"
+
+#define KLOG_MASK (KLOG_ENTRIES - 1)
+
+// 一条日志。seq 为 0 表示正在写入，写完后设为 序号 + 1
+struct klog_entry {
+    volatile u32int seq;
+    u32int level;
+    u32int tsc_low;
+    u32int tsc_high;
+    char text[KLOG_MESSAGE_SIZE];
+};
+
+static struct klog_entry klog_entries[KLOG_ENTRIES];
+
+// 下一条日志的序号。写入方用原子加法领取序号，中断中也不需要关中断
+static volatile u32int klog_head = 0;
+
+// 已经输出到串口的位置
+static u32int klog_serial_next = 0;
+
+static const char* klog_level_names[] = {"ERR", "WRN", "INF", "DBG"};
+
+#define klog_barrier() __asm__ __volatile__("" : : : "memory")
+
+static void klog_read_tsc(u32int* low, u32int* high) {
+    __asm__ __volatile__("rdtsc" : "=a" (*low), "=d" (*high));
+}
+
+void klog(u32int level, const char* message) {
+    u32int seq = __sync_fetch_and_add(&klog_head, 1);
+    struct klog_entry* entry = &klog_entries[seq & KLOG_MASK];
+    u32int i;
+
+    entry->seq = 0;
+    klog_barrier();
+
+    entry->level = level <= KLOG_DEBUG ? level : KLOG_DEBUG;
+    klog_read_tsc(&entry->tsc_low, &entry->tsc_high);
+    for (i = 0; i < KLOG_MESSAGE_SIZE - 1 && message[i] != '\0'; i++) {
+        entry->text[i] = message[i];
+    }
+    entry->text[i] = '\0';
+
+    klog_barrier();
+    entry->seq = seq + 1;
+}
+
+static u32int klog_put_hex(char* out, u32int value) {
+    const char hex_chars[] = "0123456789ABCDEF";
+
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *out++ = hex_chars[(value >> shift) & 0x0F];
+    }
+    return 8;
+}
+
+// 把序号为 seq 的日志格式化为 "[tsc] LVL message\n"。
+// 返回长度；该条尚未写完时返回 0，已被新日志覆盖时返回 -1
+static s32int klog_format(u32int seq, char* line) {
+    struct klog_entry* entry = &klog_entries[seq & KLOG_MASK];
+    u32int committed = entry->seq;
+    u32int len = 0;
+
+    if (committed == 0 || committed - 1 != seq) {
+        // 还在写（或尚未提交），或者已经被更新的日志覆盖
+        return (committed != 0 && (s32int) (committed - 1 - seq) > 0) ? -1 : 0;
+    }
+    klog_barrier();
+
+    line[len++] = '[';
+    len += klog_put_hex(&line[len], entry->tsc_high);
+    len += klog_put_hex(&line[len], entry->tsc_low);
+    line[len++] = ']';
+    line[len++] = ' ';
+    for (const char* name = klog_level_names[entry->level]; *name; name++) {
+        line[len++] = *name;
+    }
+    line[len++] = ' ';
+    for (u32int i = 0; i < KLOG_MESSAGE_SIZE && entry->text[i] != '\0'; i++) {
+        line[len++] = entry->text[i];
+    }
+    line[len++] = '\n';
+
+    // 拷贝期间被覆盖则丢弃这条
+    klog_barrier();
+    if (entry->seq != committed) {
+        return -1;
+    }
+    return (s32int) len;
+}
+
+// 格式化后的一行最长长度
+#define KLOG_LINE_SIZE (KLOG_MESSAGE_SIZE + 32)
+
+void klog_drain(void) {
+    u32int head = klog_head;
+    char line[KLOG_LINE_SIZE];
+
+    // 串口落后太多时，被覆盖的日志直接跳过
+    if (head - klog_serial_next > KLOG_ENTRIES) {
+        klog_serial_next = head - KLOG_ENTRIES;
+    }
+
+    while (klog_serial_next != head) {
+        s32int len = klog_format(klog_serial_next, line);
+        if (len == 0) {
+            break;  // 这条还没写完，下次再输出
+        }
+        if (len > 0) {
+            serial_write(line, (u32int) len);
+        }
+        klog_serial_next++;
+    }
+}
+
+void klog_dump(void) {
+    u32int head = klog_head;
+    u32int seq = head > KLOG_ENTRIES ? head - KLOG_ENTRIES : 0;
+    char line[KLOG_LINE_SIZE];
+
+    for (; seq != head; seq++) {
+        s32int len = klog_format(seq, line);
+        if (len > 0) {
+            fb_write_buffer(line, (u32int) len);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef INCLUDE_KLOG_H
+#define INCLUDE_KLOG_H
+
+#include "types.h"
+
+#define KLOG_ENTRIES      256  // 日志环大小（条数，2 的幂）
+#define KLOG_MESSAGE_SIZE 64   // 每条日志最多保存的字符数（含结尾 0）
+
+/* Severity levels */
+#define KLOG_ERROR 0
+#define KLOG_WARN  1
+#define KLOG_INFO  2
+#define KLOG_DEBUG 3
+
+// 追加一条日志，附带 TSC 时间戳；不关中断，可以在中断处理程序中调用
+void klog(u32int level, const char* message);
+
+// 把尚未输出的日志写到串口（在空闲时调用）
+void klog_drain(void);
+
+// 把环中保存的全部日志写到控制台（dmesg）
+void klog_dump(void);
+
+#endif /* INCLUDE_KLOG_H */
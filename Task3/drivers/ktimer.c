@@ -0,0 +1,271 @@
+#include "ktimer.h"
+#include "timer.h"
+#include "idle.h"
+#include "hardware_interrupt_enabler.h"
+
+#define KTIMER_ROOT_SIZE  (1 << KTIMER_ROOT_BITS)
+#define KTIMER_ROOT_MASK  (KTIMER_ROOT_SIZE - 1)
+#define KTIMER_LEVEL_SIZE (1 << KTIMER_LEVEL_BITS)
+#define KTIMER_LEVEL_MASK (KTIMER_LEVEL_SIZE - 1)
+#define KTIMER_ROOT_WORDS (KTIMER_ROOT_SIZE / 32)
+
+// 第 level 层（从 0 开始，不含第 0 层的根）每个槽的位移
+#define KTIMER_LEVEL_SHIFT(level) (KTIMER_ROOT_BITS + (level) * KTIMER_LEVEL_BITS)
+
+static struct {
+    struct ktimer* root[KTIMER_ROOT_SIZE];
+    struct ktimer* levels[KTIMER_LEVELS][KTIMER_LEVEL_SIZE];
+    u32int root_bitmap[KTIMER_ROOT_WORDS];   // 第 0 层非空槽的位图
+    u64int now;      // 时间轮处理到的 tick，之前的槽都已处理
+    u32int count;
+} ktimer_wheel;
+
+// 最近可能有定时器到期的 tick；只会偏早，不会偏晚
+static volatile u64int ktimer_next = TIMER_NO_DEADLINE;
+
+// 时钟中断发现定时器到期后置 1，由 ktimer_run 清除
+static volatile u8int ktimer_due = 0;
+
+static void ktimer_link(struct ktimer** slot, struct ktimer* timer) {
+    timer->next = *slot;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void ktimer_root_clear(u32int index) {
+    ktimer_wheel.root_bitmap[index >> 5] &= ~(1U << (index & 31));
+}
+
+static void ktimer_unlink(struct ktimer* timer) {
+    struct ktimer** slot = timer->pprev;
+
+    *slot = timer->next;
+    if (timer->next) {
+        timer->next->pprev = slot;
+    } else if (slot >= ktimer_wheel.root && slot < ktimer_wheel.root + KTIMER_ROOT_SIZE && *slot == 0) {
+        ktimer_root_clear(slot - ktimer_wheel.root);   // 第 0 层的槽空了
+    }
+    timer->next = 0;
+    timer->pprev = 0;
+}
+
+// 按距离到期的时间选择层和槽；需在关中断下调用
+static void ktimer_place(struct ktimer* timer) {
+    u64int expires = timer->expires;
+    u64int delta;
+    u32int level = 0;
+
+    if (expires < ktimer_wheel.now) {
+        expires = ktimer_wheel.now;   // 已经过期：放到下一个要处理的槽
+    }
+    delta = expires - ktimer_wheel.now;
+
+    if (delta < KTIMER_ROOT_SIZE) {
+        u32int index = expires & KTIMER_ROOT_MASK;
+
+        ktimer_link(&ktimer_wheel.root[index], timer);
+        ktimer_wheel.root_bitmap[index >> 5] |= 1U << (index & 31);
+        return;
+    }
+    if (delta >= KTIMER_MAX_DELTA) {
+        expires = ktimer_wheel.now + KTIMER_MAX_DELTA - 1;   // 先放在最远的槽，到时再重新放置
+        delta = KTIMER_MAX_DELTA - 1;
+    }
+    while (delta >= (u64int) 1 << KTIMER_LEVEL_SHIFT(level + 1)) {
+        level++;
+    }
+    ktimer_link(&ktimer_wheel.levels[level][(expires >> KTIMER_LEVEL_SHIFT(level)) & KTIMER_LEVEL_MASK], timer);
+}
+
+// 把高层一个槽中的定时器重新放到更低的层
+static void ktimer_cascade(u32int level, u32int index) {
+    struct ktimer* timer = ktimer_wheel.levels[level][index];
+
+    ktimer_wheel.levels[level][index] = 0;
+    while (timer) {
+        struct ktimer* next = timer->next;
+        ktimer_place(timer);
+        timer = next;
+    }
+}
+
+// 第 0 层中下标 index 及之后第一个非空槽，没有时返回 KTIMER_ROOT_SIZE
+static u32int ktimer_root_find(u32int index) {
+    u32int word = index >> 5;
+    u32int bits = ktimer_wheel.root_bitmap[word] & (~0U << (index & 31));
+    u32int bit;
+
+    while (bits == 0) {
+        if (++word == KTIMER_ROOT_WORDS) {
+            return KTIMER_ROOT_SIZE;
+        }
+        bits = ktimer_wheel.root_bitmap[word];
+    }
+    __asm__("bsfl %1, %0" : "=r" (bit) : "rm" (bits));
+    return (word << 5) + bit;
+}
+
+// 从 now 起第 0 层最近一个非空槽的 tick。只找到第 0 层下一次回绕为止：
+// 回绕时要从高层搬下定时器，它们可能比第 0 层后面的槽更早到期
+static u64int ktimer_next_slot(u64int now) {
+    u32int index = now & KTIMER_ROOT_MASK;
+
+    if (index != 0) {
+        index = ktimer_root_find(index);
+    }
+    return (now & ~(u64int) KTIMER_ROOT_MASK) + index;
+}
+
+static u64int ktimer_next_expiry(void) {
+    if (ktimer_wheel.count == 0) {
+        return TIMER_NO_DEADLINE;
+    }
+    return ktimer_next_slot(ktimer_wheel.now);
+}
+
+// 更新最近到期时间，并让时钟在那时产生中断（tickless 模式）
+static void ktimer_update_next(u64int expires) {
+    if (expires < ktimer_next) {
+        ktimer_next = expires;
+        timer_reprogram();
+    }
+}
+
+void ktimer_setup(struct ktimer* timer, ktimer_callback callback, void* context) {
+    timer->next = 0;
+    timer->pprev = 0;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->context = context;
+}
+
+void ktimer_add(struct ktimer* timer, u64int expires) {
+    u32int flags = save_and_disable_hardware_interrupts();
+
+    if (timer->pprev) {
+        ktimer_unlink(timer);
+    } else {
+        // 时间轮为空时 ktimer_run 不推进 now；先跟上时钟，
+        // 否则之后要在关中断下逐个 tick 追赶空闲期间的全部时间
+        if (ktimer_wheel.count == 0) {
+            ktimer_wheel.now = timer_ticks();
+        }
+        ktimer_wheel.count++;
+    }
+    timer->expires = expires;
+    ktimer_place(timer);
+    // 远处的定时器也只把时钟设置到第 0 层下一次回绕，到时从高层搬下，
+    // ktimer_run 每次只需要处理一圈之内的时间
+    ktimer_update_next(ktimer_next_expiry());
+
+    restore_hardware_interrupts(flags);
+}
+
+void ktimer_add_ms(struct ktimer* timer, u32int ms) {
+    ktimer_add(timer, timer_ticks() + timer_ms_to_ticks(ms));
+}
+
+u8int ktimer_cancel(struct ktimer* timer) {
+    u32int flags = save_and_disable_hardware_interrupts();
+    u8int pending = timer->pprev != 0;
+
+    // ktimer_next 不用更新：偏早只会多唤醒一次
+    if (pending) {
+        ktimer_unlink(timer);
+        ktimer_wheel.count--;
+    }
+    restore_hardware_interrupts(flags);
+    return pending;
+}
+
+u8int ktimer_pending(const struct ktimer* timer) {
+    return timer->pprev != 0;
+}
+
+u64int ktimer_deadline(void) {
+    return ktimer_next;
+}
+
+void ktimer_interrupt(u64int now) {
+    if (now >= ktimer_next) {
+        ktimer_next = TIMER_NO_DEADLINE;
+        ktimer_due = 1;
+        idle_notify();
+    }
+}
+
+// 运行取下的一串到期定时器。每个回调前把定时器摘下，回调运行时开中断；
+// 回调重新添加的定时器放在时间轮里，不会在这一轮再次运行
+static void ktimer_expire(struct ktimer** list, u32int* flags) {
+    struct ktimer* timer;
+
+    while ((timer = *list) != 0) {
+        ktimer_callback callback = timer->callback;
+        void* context = timer->context;
+
+        ktimer_unlink(timer);
+        ktimer_wheel.count--;
+
+        restore_hardware_interrupts(*flags);
+        callback(context);
+        *flags = save_and_disable_hardware_interrupts();
+    }
+}
+
+void ktimer_run(void) {
+    struct ktimer* expired;
+    u32int flags;
+    u64int now;
+
+    if (!ktimer_due) {
+        return;
+    }
+    now = timer_ticks();
+    flags = save_and_disable_hardware_interrupts();
+    ktimer_due = 0;
+
+    // 按槽推进：空槽直接跳到下一个非空槽或第 0 层的回绕，
+    // 第 0 层每转一圈从上一层搬下一个槽。每处理完一个槽开一次中断
+    while (ktimer_wheel.now <= now && ktimer_wheel.count > 0) {
+        u32int index = ktimer_wheel.now & KTIMER_ROOT_MASK;
+
+        if (index == 0) {
+            for (u32int level = 0; level < KTIMER_LEVELS; level++) {
+                u32int slot = (ktimer_wheel.now >> KTIMER_LEVEL_SHIFT(level)) & KTIMER_LEVEL_MASK;
+                ktimer_cascade(level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        if (ktimer_wheel.root[index] == 0) {
+            u64int next = ktimer_next_slot(ktimer_wheel.now + 1);
+            ktimer_wheel.now = next <= now ? next : now + 1;
+        } else {
+            // 先把整个槽取下并推进时间轮，回调中添加的已到期定时器会落到下一个槽
+            expired = ktimer_wheel.root[index];
+            ktimer_wheel.root[index] = 0;
+            ktimer_root_clear(index);
+            expired->pprev = &expired;
+            ktimer_wheel.now++;
+            ktimer_expire(&expired, &flags);
+        }
+        restore_hardware_interrupts(flags);
+        flags = save_and_disable_hardware_interrupts();
+    }
+    if (ktimer_wheel.count == 0 && ktimer_wheel.now <= now) {
+        ktimer_wheel.now = now + 1;   // 时间轮为空，直接跟上时钟
+    }
+
+    ktimer_next = TIMER_NO_DEADLINE;
+    ktimer_update_next(ktimer_next_expiry());
+    restore_hardware_interrupts(flags);
+}
+
+u32int ktimer_count(void) {
+    return ktimer_wheel.count;
+}
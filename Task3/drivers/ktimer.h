@@ -0,0 +1,53 @@
+#ifndef INCLUDE_KTIMER_H
+#define INCLUDE_KTIMER_H
+
+#include "types.h"
+
+// 分层时间轮：第 0 层 256 个槽，每槽 1 个 tick；往上三层各 64 个槽，
+// 每槽的跨度依次乘以 64。最远可以覆盖 2^26 个 tick，更远的定时器先放在
+// 最高层，到时再重新放置
+#define KTIMER_ROOT_BITS  8
+#define KTIMER_LEVEL_BITS 6
+#define KTIMER_LEVELS     3   // 第 0 层之上的层数
+#define KTIMER_MAX_DELTA  (1UL << (KTIMER_ROOT_BITS + KTIMER_LEVELS * KTIMER_LEVEL_BITS))
+
+// 回调在空闲工作中运行（开中断，不在中断处理程序中），可以重新添加定时器
+typedef void (*ktimer_callback)(void* context);
+
+// 定时器由调用方分配，链表指针嵌在结构中，添加和取消都不需要分配内存
+struct ktimer {
+    struct ktimer* next;
+    struct ktimer** pprev;   // 指向前一个节点的 next（或槽头）；为 0 表示未在时间轮中
+    u64int expires;          // 到期的 tick 数
+    ktimer_callback callback;
+    void* context;
+};
+
+// 设置回调；定时器必须先调用它再使用
+void ktimer_setup(struct ktimer* timer, ktimer_callback callback, void* context);
+
+// 在 tick 数到达 expires 时运行回调（O(1)）。已在时间轮中的定时器会被移到新的时间
+void ktimer_add(struct ktimer* timer, u64int expires);
+
+// 在 ms 毫秒后运行回调
+void ktimer_add_ms(struct ktimer* timer, u32int ms);
+
+// 取消定时器（O(1)）；返回 1 表示取消前定时器尚未到期
+u8int ktimer_cancel(struct ktimer* timer);
+
+u8int ktimer_pending(const struct ktimer* timer);
+
+// 时钟中断调用：最近的定时器到期时唤醒主循环，只做一次比较
+void ktimer_interrupt(u64int now);
+
+// 最近可能有定时器到期的 tick（只会偏早），没有时为 TIMER_NO_DEADLINE。
+// tickless 模式按它和 timer_set_deadline 的截止时间中较早的一个设置计数
+u64int ktimer_deadline(void);
+
+// 下半部：推进时间轮，成批运行到期的回调（在空闲循环中调用）
+void ktimer_run(void);
+
+// 时间轮中的定时器个数
+u32int ktimer_count(void);
+
+#endif /* INCLUDE_KTIMER_H */
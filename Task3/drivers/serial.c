@@ -0,0 +1,362 @@
+#include "serial.h"
+#include "io.h"
+#include "hardware_interrupt_enabler.h"
+#include "input_buffer.h"
+#include "keyboard.h"
+#include "klog.h"
+#include "wait.h"
+#include "interrupts.h"
+#include "pic.h"
+#include "ktimer.h"
+
+/* The I/O ports */
+#define SERIAL_DATA_PORT(base)          (base)
+#define SERIAL_INT_ENABLE_PORT(base)    (base + 1)
+#define SERIAL_FIFO_COMMAND_PORT(base)  (base + 2)   // 写：FCR，读：IIR
+#define SERIAL_LINE_COMMAND_PORT(base)  (base + 3)
+#define SERIAL_MODEM_COMMAND_PORT(base) (base + 4)
+#define SERIAL_LINE_STATUS_PORT(base)   (base + 5)
+#define SERIAL_MODEM_STATUS_PORT(base)  (base + 6)
+
+/* The I/O port commands */
+#define SERIAL_LINE_ENABLE_DLAB         0x80
+#define SERIAL_LINE_8N1                 0x03
+#define SERIAL_FIFO_ENABLE_CLEAR_14     0xC7   // 打开并清空 FIFO，接收阈值 14 字节
+#define SERIAL_MODEM_DTR_RTS_OUT2       0x0B   // OUT2 必须置位，否则中断到不了 PIC
+#define SERIAL_DIVISOR_115200           1
+
+#define SERIAL_IER_DATA_AVAILABLE       0x01
+#define SERIAL_IER_THR_EMPTY            0x02
+
+#define SERIAL_LSR_DATA_READY           0x01
+#define SERIAL_LSR_THR_EMPTY            0x20
+
+#define SERIAL_IIR_NO_INTERRUPT         0x01
+#define SERIAL_IIR_ID(iir)              (((iir) >> 1) & 0x07)
+#define SERIAL_IIR_MODEM_STATUS         0x00
+#define SERIAL_IIR_THR_EMPTY            0x01
+#define SERIAL_IIR_DATA_AVAILABLE       0x02
+#define SERIAL_IIR_LINE_STATUS          0x03
+#define SERIAL_IIR_CHAR_TIMEOUT         0x06
+
+// 16550 的发送 FIFO 深度：THR 空时一次最多可以写入的字节数
+#define SERIAL_TX_FIFO_SIZE             16
+
+#define SERIAL_TX_MASK (SERIAL_TX_BUFFER_SIZE - 1)
+
+// 发送环形缓冲区：head 由写入方推进，tail 由中断处理程序推进
+static struct {
+    u8int buffer[SERIAL_TX_BUFFER_SIZE];
+    volatile u32int head;
+    volatile u32int tail;
+} serial_tx;
+
+#define SERIAL_RX_MASK (SERIAL_RX_BUFFER_SIZE - 1)
+
+// 下半部每次写入输入缓冲区的事件数
+#define SERIAL_EVENT_BATCH 16
+
+// 接收环：head 由中断处理程序推进，tail 由下半部推进
+static struct {
+    u8int buffer[SERIAL_RX_BUFFER_SIZE];
+    volatile u32int head;
+    volatile u32int tail;
+} serial_rx;
+
+#define serial_barrier() __asm__ __volatile__("" : : : "memory")
+
+static u8int serial_ready = 0;
+
+// 接收环满时丢弃的字节数；上一个字节是否被丢弃，用来只在开始丢弃时记一条日志
+static u32int serial_rx_drops = 0;
+static u8int serial_rx_dropping = 0;
+
+// 上一个收到的字节是否为 '\r'，用于把 "\r\n" 合并成一个换行
+static u8int serial_last_cr = 0;
+
+// 收到 ESC 后等待后续字节的定时器
+static struct ktimer serial_escape_timer;
+
+static void serial_handle_interrupt(struct trap_frame* frame, void* context);
+static void serial_escape_expired(void* context);
+
+// THR 空时把缓冲区中的数据一次写满 FIFO；需在关中断或中断处理程序中调用
+static void serial_fill_fifo(void) {
+    u32int count = 0;
+
+    if (!(inb(SERIAL_LINE_STATUS_PORT(SERIAL_COM1_BASE)) & SERIAL_LSR_THR_EMPTY)) {
+        return;
+    }
+    while (count < SERIAL_TX_FIFO_SIZE && serial_tx.tail != serial_tx.head) {
+        outb(SERIAL_DATA_PORT(SERIAL_COM1_BASE), serial_tx.buffer[serial_tx.tail & SERIAL_TX_MASK]);
+        serial_tx.tail++;
+        count++;
+    }
+}
+
+// 发送器空闲（或者 THR 空中断丢失）时重新开始发送
+static void serial_kick(void) {
+    u32int flags = save_and_disable_hardware_interrupts();
+    serial_fill_fifo();
+    restore_hardware_interrupts(flags);
+}
+
+void serial_init(void) {
+    u16int base = SERIAL_COM1_BASE;
+
+    // 先关闭串口中断
+    outb(SERIAL_INT_ENABLE_PORT(base), 0x00);
+
+    // 设置波特率除数
+    outb(SERIAL_LINE_COMMAND_PORT(base), SERIAL_LINE_ENABLE_DLAB);
+    outb(SERIAL_DATA_PORT(base), SERIAL_DIVISOR_115200 & 0x00FF);
+    outb(SERIAL_INT_ENABLE_PORT(base), (SERIAL_DIVISOR_115200 >> 8) & 0x00FF);
+
+    // 8 位数据，无校验，1 位停止位
+    outb(SERIAL_LINE_COMMAND_PORT(base), SERIAL_LINE_8N1);
+    outb(SERIAL_FIFO_COMMAND_PORT(base), SERIAL_FIFO_ENABLE_CLEAR_14);
+    outb(SERIAL_MODEM_COMMAND_PORT(base), SERIAL_MODEM_DTR_RTS_OUT2);
+
+    serial_tx.head = 0;
+    serial_tx.tail = 0;
+    ktimer_setup(&serial_escape_timer, serial_escape_expired, 0);
+
+    // 打开接收和 THR 空中断
+    irq_register(PIC_1_OFFSET + SERIAL_COM1_IRQ, serial_handle_interrupt, 0);
+    outb(SERIAL_INT_ENABLE_PORT(base), SERIAL_IER_DATA_AVAILABLE | SERIAL_IER_THR_EMPTY);
+    irq_unmask(SERIAL_COM1_IRQ);
+    serial_ready = 1;
+}
+
+// 发送缓冲区是否还有空间；在关中断下被 wait_until 调用，顺便把数据推进 FIFO
+static u32int serial_tx_has_room(void* context) {
+    (void)context;
+    serial_fill_fifo();
+    return serial_tx.head - serial_tx.tail < SERIAL_TX_BUFFER_SIZE;
+}
+
+// 放入一个字节；缓冲区满时睡眠，等中断把数据发出去
+static void serial_put(u8int c) {
+    if (serial_tx.head - serial_tx.tail >= SERIAL_TX_BUFFER_SIZE) {
+        wait_until(serial_tx_has_room, 0);
+    }
+    serial_tx.buffer[serial_tx.head & SERIAL_TX_MASK] = c;
+    serial_barrier();
+    serial_tx.head++;
+}
+
+void serial_write(const char* buf, u32int len) {
+    if (!serial_ready) {
+        return;
+    }
+    for (u32int i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            serial_put('\r');
+        }
+        serial_put((u8int) buf[i]);
+    }
+    serial_kick();
+}
+
+void serial_write_string(const char* str) {
+    u32int len = 0;
+    while (str[len]) {
+        len++;
+    }
+    serial_write(str, len);
+}
+
+// 取空接收 FIFO（最多 16 字节）放入接收环，环满时丢弃并计数
+static void serial_receive(void) {
+    u16int base = SERIAL_COM1_BASE;
+
+    while (inb(SERIAL_LINE_STATUS_PORT(base)) & SERIAL_LSR_DATA_READY) {
+        u8int c = inb(SERIAL_DATA_PORT(base));
+
+        if (serial_rx.head - serial_rx.tail >= SERIAL_RX_BUFFER_SIZE) {
+            serial_rx_drops++;
+            if (!serial_rx_dropping) {
+                serial_rx_dropping = 1;
+                klog(KLOG_WARN, "COM1 receive ring full, dropping bytes");
+            }
+            continue;
+        }
+        serial_rx_dropping = 0;
+        serial_rx.buffer[serial_rx.head & SERIAL_RX_MASK] = c;
+        serial_barrier();
+        serial_rx.head++;
+    }
+}
+
+u32int serial_rx_dropped(void) {
+    return serial_rx_drops;
+}
+
+// ANSI 转义序列（ESC [ 参数 终止符）的解析状态
+#define SERIAL_ESCAPE_NONE    0
+#define SERIAL_ESCAPE_START   1   // 收到 ESC
+#define SERIAL_ESCAPE_CSI     2   // 收到 ESC [
+
+// 单独按下的 Esc 后面没有其他字节：等这么久仍没有后续字节就当作 Esc 键
+#define SERIAL_ESCAPE_TIMEOUT_MS 50
+
+static u8int serial_escape = SERIAL_ESCAPE_NONE;
+static u32int serial_escape_param = 0;
+static u8int serial_escape_param_done = 0;   // 只使用第一个参数，';' 之后的不再累加
+
+// 终端发送的光标键序列对应的键码；不认识的返回 0
+static u32int serial_escape_key(u8int final, u32int param) {
+    switch (final) {
+        case 'A': return KEYBOARD_KEY_UP;
+        case 'B': return KEYBOARD_KEY_DOWN;
+        case 'C': return KEYBOARD_KEY_RIGHT;
+        case 'D': return KEYBOARD_KEY_LEFT;
+        case 'H': return KEYBOARD_KEY_HOME;
+        case 'F': return KEYBOARD_KEY_END;
+        case '~':
+            switch (param) {
+                case 1: case 7: return KEYBOARD_KEY_HOME;
+                case 2:         return KEYBOARD_KEY_INSERT;
+                case 3:         return KEYBOARD_KEY_DELETE;
+                case 4: case 8: return KEYBOARD_KEY_END;
+                case 5:         return KEYBOARD_KEY_PAGE_UP;
+                case 6:         return KEYBOARD_KEY_PAGE_DOWN;
+                default:        return 0;
+            }
+        default:
+            return 0;
+    }
+}
+
+// 处理 CSI 序列（ESC [ 之后）中的一个字节。参数和中间字节（0x20-0x3F）全部吞掉，
+// 终止字节（0x40-0x7E）结束序列；返回完整序列对应的键码，序列未完或无法识别时返回 0。
+// 其他字节（控制字符）中止序列，*reprocess 置 1 表示该字节按普通字符处理
+static u32int serial_escape_byte(u8int c, u8int* reprocess) {
+    if (c >= '0' && c <= '9') {
+        if (!serial_escape_param_done) {
+            serial_escape_param = serial_escape_param * 10 + (c - '0');
+        }
+        return 0;
+    }
+    if (c >= 0x20 && c <= 0x3F) {
+        serial_escape_param_done = 1;
+        return 0;
+    }
+    serial_escape = SERIAL_ESCAPE_NONE;
+    if (c >= 0x40 && c <= 0x7E) {
+        return serial_escape_key(c, serial_escape_param);
+    }
+    *reprocess = 1;
+    return 0;
+}
+
+// 放入一个按键事件，攒满一批时写入输入缓冲区
+static void serial_queue(u32int* events, u32int* count, u32int key) {
+    events[(*count)++] = KEYBOARD_EVENT(key, 0, 0);
+    if (*count == SERIAL_EVENT_BATCH) {
+        buffer_putn(INPUT_SOURCE_SERIAL, events, *count);
+        *count = 0;
+    }
+}
+
+// ESC 之后一段时间没有收到后续字节：是单独按下的 Esc 键
+static void serial_escape_expired(void* context) {
+    u32int event = KEYBOARD_EVENT(0x1B, 0, 0);
+
+    (void)context;
+    if (serial_escape == SERIAL_ESCAPE_START) {
+        serial_escape = SERIAL_ESCAPE_NONE;
+        buffer_putn(INPUT_SOURCE_SERIAL, &event, 1);
+    }
+}
+
+// 把接收到的字节转换成终端使用的字符，成批放入输入缓冲区
+void serial_process(void) {
+    u32int events[SERIAL_EVENT_BATCH];
+    u32int count = 0;
+
+    while (serial_rx.tail != serial_rx.head) {
+        serial_barrier();
+        u8int c = serial_rx.buffer[serial_rx.tail & SERIAL_RX_MASK];
+        u8int reprocess = 0;
+        serial_rx.tail++;
+
+        if (serial_escape == SERIAL_ESCAPE_START) {
+            ktimer_cancel(&serial_escape_timer);
+            if (c == '[') {
+                serial_escape = SERIAL_ESCAPE_CSI;
+                serial_escape_param = 0;
+                serial_escape_param_done = 0;
+                continue;
+            }
+            // 不是 CSI：前面的 ESC 是单独的 Esc 键，这个字节照常处理
+            serial_escape = SERIAL_ESCAPE_NONE;
+            serial_queue(events, &count, 0x1B);
+        } else if (serial_escape == SERIAL_ESCAPE_CSI) {
+            // 光标键等以 ESC [ 开头，转换成与键盘相同的按键事件
+            u32int key = serial_escape_byte(c, &reprocess);
+            if (key != 0) {
+                serial_queue(events, &count, key);
+            }
+            if (!reprocess) {
+                continue;
+            }
+        }
+
+        if (c == 0x1B) {
+            serial_escape = SERIAL_ESCAPE_START;
+            ktimer_add_ms(&serial_escape_timer, SERIAL_ESCAPE_TIMEOUT_MS);
+            continue;
+        }
+        if (c == 0) {
+            continue;   // 事件 0 表示“没有按键”，NUL 不放入输入缓冲区
+        }
+        if (c == '\n' && serial_last_cr) {
+            serial_last_cr = 0;
+            continue;
+        }
+        serial_last_cr = (c == '\r');
+
+        if (c == '\r') {
+            c = '\n';
+        } else if (c == 0x7F) {
+            c = '\b';   // 终端发送的 DEL 当作退格
+        }
+        serial_queue(events, &count, c);
+    }
+    if (count > 0) {
+        buffer_putn(INPUT_SOURCE_SERIAL, events, count);
+    }
+}
+
+// COM1 中断处理：发送时补满 FIFO，收到的字节只放入接收环
+static void serial_handle_interrupt(struct trap_frame* frame, void* context) {
+    u16int base = SERIAL_COM1_BASE;
+    u8int iir;
+
+    (void)frame;
+    (void)context;
+
+    // 一次中断可能对应多个原因，读 IIR 直到没有待处理的中断
+    while (!((iir = inb(SERIAL_FIFO_COMMAND_PORT(base))) & SERIAL_IIR_NO_INTERRUPT)) {
+        switch (SERIAL_IIR_ID(iir)) {
+            case SERIAL_IIR_THR_EMPTY:
+                serial_fill_fifo();
+                break;
+            case SERIAL_IIR_DATA_AVAILABLE:
+            case SERIAL_IIR_CHAR_TIMEOUT:
+                serial_receive();
+                input_notify();
+                break;
+            case SERIAL_IIR_LINE_STATUS:
+                inb(SERIAL_LINE_STATUS_PORT(base));
+                klog(KLOG_WARN, "COM1 line status error");
+                break;
+            case SERIAL_IIR_MODEM_STATUS:
+                inb(SERIAL_MODEM_STATUS_PORT(base));
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef INCLUDE_SERIAL_H
+#define INCLUDE_SERIAL_H
+
+#include "types.h"
+
+#define SERIAL_COM1_BASE 0x3F8   // COM1 基地址
+#define SERIAL_COM1_IRQ  4       // COM1 使用 IRQ4
+
+#define SERIAL_TX_BUFFER_SIZE 4096  // 发送环形缓冲区大小（2 的幂）
+#define SERIAL_RX_BUFFER_SIZE 256   // 接收原始字节环大小（2 的幂）
+
+// 初始化 COM1：115200 8N1，打开 FIFO，注册并打开 IRQ4
+void serial_init(void);
+
+// 把数据放入发送缓冲区后立即返回，由 THR 空中断在后台发送
+// '\n' 会被转换为 "\r\n"
+void serial_write(const char* buf, u32int len);
+void serial_write_string(const char* str);
+
+// 下半部：把接收环中的字节转换后放入输入缓冲区（在空闲循环中调用）
+void serial_process(void);
+
+// 接收环满时丢弃的字节数
+u32int serial_rx_dropped(void);
+
+#endif /* INCLUDE_SERIAL_H */
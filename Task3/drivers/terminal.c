@@ -1,194 +1,488 @@
-#include "terminal.h"
-#include "frame_buffer.h"
-#include "input_buffer.h"
-#include "io.h"
-
-// 命令表
-static struct command commands[] = {
-    {"echo", cmd_echo, "Display the provided text"},
-    {"clear", cmd_clear, "Clear the screen"},
-    {"help", cmd_help, "Display available commands"},
-    {"version", cmd_version, "Display OS version"},
-    {"shutdown", cmd_shutdown, "Prepare system for shutdown"},
-    {0, 0, 0}  // 结束标记
-};
-
-// 系统信息
-static const char* OS_NAME = "MyOS";
-static const char* OS_VERSION = "1.0.0";
-
-// 初始化终端
-void terminal_init(void) {
-    fb_clear();
-    fb_write_string("=== ");
-    fb_write_string(OS_NAME);
-    fb_write_string(" Terminal ===\n");
-    fb_write_string("Type 'help' for available commands\n\n");
-}
-
-// 显示提示符
-void terminal_prompt(void) {
-    fb_write_string("myos> ");
-}
-
-// 运行终端主循环
-void terminal_run(void) {
-    char input[LINE_BUFFER_SIZE];
-    
-    while (1) {
-        terminal_prompt();
-        
-        // 读取用户输入
-        u32int len = readline(input, LINE_BUFFER_SIZE);
-        
-        if (len > 0) {
-            terminal_execute(input);
-        }
-        
-        fb_write_string("\n");
-    }
-}
-
-// 解析和执行命令
-void terminal_execute(char* input) {
-    // 跳过前导空格
-    while (*input == ' ') input++;
-    
-    // 检查空输入
-    if (*input == '\0') {
-        return;
-    }
-    
-    // 查找命令结束位置（空格或字符串结束）
-    char* command_end = input;
-    while (*command_end != ' ' && *command_end != '\0') {
-        command_end++;
-    }
-    
-    // 提取命令名
-    char command_name[32];
-    u32int command_len = command_end - input;
-    if (command_len >= sizeof(command_name)) {
-        command_len = sizeof(command_name) - 1;
-    }
-    
-    for (u32int i = 0; i < command_len; i++) {
-        command_name[i] = input[i];
-    }
-    command_name[command_len] = '\0';
-    
-    // 提取参数（跳过命令后的空格）
-    char* args = command_end;
-    while (*args == ' ') args++;
-    
-    // 在命令表中查找命令
-    struct command* cmd = commands;
-    while (cmd->name != 0) {
-        // 简单的字符串比较
-        u32int i = 0;
-        u8int match = 1;
-        
-        while (command_name[i] != '\0' && cmd->name[i] != '\0') {
-            if (command_name[i] != cmd->name[i]) {
-                match = 0;
-                break;
-            }
-            i++;
-        }
-        
-        // 确保两个字符串同时结束
-        if (match && command_name[i] == '\0' && cmd->name[i] == '\0') {
-            // 找到命令，执行
-            cmd->function(args);
-            return;
-        }
-        
-        cmd++;
-    }
-    
-    // 命令未找到
-    fb_write_string("Unknown command: '");
-    fb_write_string(command_name);
-    fb_write_string("'\n");
-    fb_write_string("Type 'help' for available commands\n");
-}
-
-// echo命令：显示提供的文本
-void cmd_echo(char* args) {
-    if (*args == '\0') {
-        fb_write_string("Usage: echo <text>\n");
-        return;
-    }
-    
-    fb_write_string(args);
-    fb_write_string("\n");
-}
-
-// clear命令：清屏
-void cmd_clear(char* args) {
-    (void)args; // 未使用参数
-    fb_clear();
-}
-
-// help命令：显示可用命令
-void cmd_help(char* args) {
-    (void)args; // 未使用参数
-    
-    fb_write_string("Available commands:\n");  // 确保换行
-    fb_write_string("===================\n");
-    
-    struct command* cmd = commands;
-    while (cmd->name != 0) {
-        fb_write_string("  ");
-        fb_write_string(cmd->name);
-        
-        // 计算命令名长度用于对齐
-        u32int name_len = 0;
-        const char* name_ptr = cmd->name;
-        while (*name_ptr != '\0') {
-            name_len++;
-            name_ptr++;
-        }
-        
-        // 使用空格而不是制表符进行对齐
-        // 根据名称长度添加适当数量的空格
-        if (name_len < 8) {
-            fb_write_string("        ");  // 8个空格
-        } else {
-            fb_write_string("    ");      // 4个空格
-        }
-        
-        fb_write_string("- ");  // 使用连字符作为分隔符
-        fb_write_string(cmd->description);
-        fb_write_string("\n");  // 确保每个命令换行
-        
-        cmd++;
-    }
-}
-
-// version命令：显示操作系统版本
-void cmd_version(char* args) {
-    (void)args; // 未使用参数
-    
-    fb_write_string(OS_NAME);
-    fb_write_string(" version ");
-    fb_write_string(OS_VERSION);
-    fb_write_string("\n");
-    fb_write_string("Simple operating system for educational purposes\n");
-}
-
-// shutdown命令：准备系统关机
-void cmd_shutdown(char* args) {
-    (void)args; // 未使用参数
-    
-    fb_write_string("System is shutting down...\n");
-    fb_write_string("Thank you for using ");
-    fb_write_string(OS_NAME);
-    fb_write_string("!\n");
-    
-    // 在实际操作系统中，这里会执行真正的关机程序
-    // 现在我们只是显示消息并停止接受新命令
-    while (1) {
-        __asm__ __volatile__("hlt");
-    }
-}
\ No newline at end of file
+#include "terminal.h"
+#include "frame_buffer.h"
+#include "input_buffer.h"
+#include "io.h"
+#include "keyboard.h"
+#include "klog.h"
+#include "serial.h"
+#include "timer.h"
+#include "ktimer.h"
+#include "interrupts.h"
+#include "apic.h"
+
+// 命令表
+static struct command commands[] = {
+    {"echo", cmd_echo, "Display the provided text"},
+    {"clear", cmd_clear, "Clear the screen"},
+    {"help", cmd_help, "Display available commands"},
+    {"version", cmd_version, "Display OS version"},
+    {"shutdown", cmd_shutdown, "Prepare system for shutdown"},
+    {"stats", cmd_stats, "Display driver statistics"},
+    {"dmesg", cmd_dmesg, "Display the kernel log"},
+    {"kbd", cmd_kbd, "Set keyboard repeat rate, LEDs"},
+    {"uptime", cmd_uptime, "Display time since boot"},
+    {"sleep", cmd_sleep, "Sleep for the given milliseconds"},
+    {"timer", cmd_timer, "Display or set the timer mode"},
+    {"scroll", cmd_scroll, "Select hardware or copy scrolling"},
+    {0, 0, 0}  // 结束标记
+};
+
+// 系统信息
+static const char* OS_NAME = "MyOS";
+static const char* OS_VERSION = "1.0.0";
+
+// 初始化终端：每个虚拟控制台都是一个独立的会话
+void terminal_init(void) {
+    // 命令输出以内存速度写入影子缓冲区，空闲时再渲染
+    fb_set_deferred(1);
+
+    for (u32int i = FB_CONSOLE_COUNT; i-- > 0;) {
+        fb_console_select(i);
+        fb_clear();
+        fb_write_string("=== ");
+        fb_write_string(OS_NAME);
+        fb_write_string(" Terminal ===\n");
+        fb_write_string("Alt+F1..F4 switch consoles\n");
+        fb_write_string("Type 'help' for available commands\n\n");
+
+        // 后台控制台先显示提示符，当前控制台的提示符由主循环打印
+        if (i != 0) {
+            terminal_prompt();
+        }
+    }
+    fb_console_switch(0);
+}
+
+// 显示提示符
+void terminal_prompt(void) {
+    fb_write_string("myos> ");
+    // 刷新屏障：提示符出现时，之前的输出必须已经显示出来
+    fb_flush();
+}
+
+// 运行终端主循环
+void terminal_run(void) {
+    char input[LINE_BUFFER_SIZE];
+    
+    while (1) {
+        terminal_prompt();
+        
+        // 读取用户输入
+        u32int len = readline(input, LINE_BUFFER_SIZE);
+        
+        if (len > 0) {
+            terminal_execute(input);
+        }
+        
+        fb_write_string("\n");
+    }
+}
+
+// 解析和执行命令
+void terminal_execute(char* input) {
+    // 跳过前导空格
+    while (*input == ' ') input++;
+    
+    // 检查空输入
+    if (*input == '\0') {
+        return;
+    }
+    
+    // 查找命令结束位置（空格或字符串结束）
+    char* command_end = input;
+    while (*command_end != ' ' && *command_end != '\0') {
+        command_end++;
+    }
+    
+    // 提取命令名
+    char command_name[32];
+    u32int command_len = command_end - input;
+    if (command_len >= sizeof(command_name)) {
+        command_len = sizeof(command_name) - 1;
+    }
+    
+    for (u32int i = 0; i < command_len; i++) {
+        command_name[i] = input[i];
+    }
+    command_name[command_len] = '\0';
+    
+    // 提取参数（跳过命令后的空格）
+    char* args = command_end;
+    while (*args == ' ') args++;
+    
+    // 在命令表中查找命令
+    struct command* cmd = commands;
+    while (cmd->name != 0) {
+        // 简单的字符串比较
+        u32int i = 0;
+        u8int match = 1;
+        
+        while (command_name[i] != '\0' && cmd->name[i] != '\0') {
+            if (command_name[i] != cmd->name[i]) {
+                match = 0;
+                break;
+            }
+            i++;
+        }
+        
+        // 确保两个字符串同时结束
+        if (match && command_name[i] == '\0' && cmd->name[i] == '\0') {
+            // 找到命令，执行
+            cmd->function(args);
+            return;
+        }
+        
+        cmd++;
+    }
+    
+    // 命令未找到
+    fb_write_string("Unknown command: '");
+    fb_write_string(command_name);
+    fb_write_string("'\n");
+    fb_write_string("Type 'help' for available commands\n");
+}
+
+// 从参数中取出下一个以空格分隔的单词，返回其长度（0 表示没有更多单词）
+static u32int terminal_next_word(char** args, char* word, u32int size) {
+    char* p = *args;
+    u32int len = 0;
+
+    while (*p == ' ') p++;
+    while (*p != ' ' && *p != '\0') {
+        if (len < size - 1) {
+            word[len++] = *p;
+        }
+        p++;
+    }
+    word[len] = '\0';
+    *args = p;
+    return len;
+}
+
+// 比较两个字符串是否相同
+static u8int terminal_equal(const char* a, const char* b) {
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// 解析十进制数；格式错误时返回 0
+static u8int terminal_parse_dec(const char* word, u32int* value) {
+    u32int result = 0;
+
+    if (*word == '\0') {
+        return 0;
+    }
+    for (; *word != '\0'; word++) {
+        if (*word < '0' || *word > '9' || result > 100000) {
+            return 0;
+        }
+        result = result * 10 + (u32int) (*word - '0');
+    }
+    *value = result;
+    return 1;
+}
+
+// echo命令：显示提供的文本
+void cmd_echo(char* args) {
+    if (*args == '\0') {
+        fb_write_string("Usage: echo <text>\n");
+        return;
+    }
+    
+    fb_write_string(args);
+    fb_write_string("\n");
+}
+
+// clear命令：清屏
+void cmd_clear(char* args) {
+    (void)args; // 未使用参数
+    fb_clear();
+}
+
+// help命令：显示可用命令
+void cmd_help(char* args) {
+    (void)args; // 未使用参数
+    
+    fb_write_string("Available commands:\n");  // 确保换行
+    fb_write_string("===================\n");
+    
+    struct command* cmd = commands;
+    while (cmd->name != 0) {
+        fb_write_string("  ");
+        fb_write_string(cmd->name);
+        
+        // 计算命令名长度用于对齐
+        u32int name_len = 0;
+        const char* name_ptr = cmd->name;
+        while (*name_ptr != '\0') {
+            name_len++;
+            name_ptr++;
+        }
+        
+        // 使用空格而不是制表符进行对齐
+        // 根据名称长度添加适当数量的空格
+        if (name_len < 8) {
+            fb_write_string("        ");  // 8个空格
+        } else {
+            fb_write_string("    ");      // 4个空格
+        }
+        
+        fb_write_string("- ");  // 使用连字符作为分隔符
+        fb_write_string(cmd->description);
+        fb_write_string("\n");  // 确保每个命令换行
+        
+        cmd++;
+    }
+}
+
+// version命令：显示操作系统版本
+void cmd_version(char* args) {
+    (void)args; // 未使用参数
+    
+    fb_write_string(OS_NAME);
+    fb_write_string(" version ");
+    fb_write_string(OS_VERSION);
+    fb_write_string("\n");
+    fb_write_string("Simple operating system for educational purposes\n");
+}
+
+// shutdown命令：准备系统关机
+void cmd_shutdown(char* args) {
+    (void)args; // 未使用参数
+    
+    fb_write_string("System is shutting down...\n");
+    fb_write_string("Thank you for using ");
+    fb_write_string(OS_NAME);
+    fb_write_string("!\n");
+    
+    // 在实际操作系统中，这里会执行真正的关机程序
+    // 现在我们只是显示消息并停止接受新命令
+    fb_flush();
+    while (1) {
+        __asm__ __volatile__("hlt");
+    }
+}
+
+// 输出 "  name: value"
+static void terminal_write_counter(const char* name, u32int value) {
+    fb_write_string("  ");
+    fb_write_string(name);
+    fb_write_string(": ");
+    fb_write_dec(value);
+    fb_write_string("\n");
+}
+
+// 显示输入路径统计
+static void terminal_input_stats(void) {
+    static const char* source_names[INPUT_SOURCE_COUNT] = {"keyboard", "serial", "other"};
+    struct input_stats input;
+
+    input_get_stats(&input);
+    fb_write_string("Input buffer (");
+    fb_write_dec(INPUT_BUFFER_SIZE);
+    fb_write_string(" events):\n");
+    terminal_write_counter("enqueued", input.enqueued);
+    terminal_write_counter("dropped (buffer full)", input.dropped);
+    terminal_write_counter("high-water mark", input.high_water);
+    for (u32int i = 0; i < INPUT_SOURCE_COUNT; i++) {
+        fb_write_string("  ");
+        fb_write_string(source_names[i]);
+        fb_write_string(": ");
+        fb_write_dec(input.source_enqueued[i]);
+        fb_write_string(" enqueued, ");
+        fb_write_dec(input.source_dropped[i]);
+        fb_write_string(" dropped\n");
+        if (i == INPUT_SOURCE_SERIAL) {
+            terminal_write_counter("  COM1 receive ring dropped (bytes)", serial_rx_dropped());
+        }
+    }
+}
+
+// stats命令：显示驱动统计信息；"stats input" 只显示输入路径
+void cmd_stats(char* args) {
+    struct keyboard_stats keyboard;
+    char word[16];
+
+    terminal_next_word(&args, word, sizeof(word));
+    if (terminal_equal(word, "input")) {
+        terminal_input_stats();
+        return;
+    }
+    if (word[0] != '\0') {
+        fb_write_string("Usage: stats [input]\n");
+        return;
+    }
+
+    fb_write_string("Console:\n");
+    terminal_write_counter("cursor port writes avoided", fb_cursor_writes_avoided());
+
+    keyboard_get_stats(&keyboard);
+    fb_write_string("Keyboard:\n");
+    terminal_write_counter("interrupts", keyboard.interrupts);
+    terminal_write_counter("bytes read", keyboard.bytes);
+    terminal_write_counter("controller overruns", keyboard.overruns);
+    terminal_write_counter("dropped (ring full)", keyboard.dropped);
+
+    terminal_input_stats();
+}
+
+// dmesg命令：显示内核日志
+void cmd_dmesg(char* args) {
+    (void)args; // 未使用参数
+
+    klog_dump();
+}
+// 报告键盘命令的执行结果
+static void terminal_keyboard_result(s32int result) {
+    if (result == KEYBOARD_COMMAND_OK) {
+        fb_write_string("OK\n");
+    } else if (result == KEYBOARD_COMMAND_TIMEOUT) {
+        fb_write_string("Keyboard did not respond\n");
+    } else {
+        fb_write_string("Keyboard rejected the command\n");
+    }
+}
+
+// kbd命令：设置键盘连发速率/延迟、指示灯和软件连发开关
+void cmd_kbd(char* args) {
+    char word[16];
+    u32int first;
+    u32int second;
+
+    terminal_next_word(&args, word, sizeof(word));
+
+    if (terminal_equal(word, "rate")) {
+        char rate[16];
+        char delay[16];
+        terminal_next_word(&args, rate, sizeof(rate));
+        terminal_next_word(&args, delay, sizeof(delay));
+        if (terminal_parse_dec(rate, &first) && first <= KEYBOARD_TYPEMATIC_RATE_MAX &&
+            terminal_parse_dec(delay, &second) && second <= KEYBOARD_TYPEMATIC_DELAY_MAX) {
+            terminal_keyboard_result(keyboard_set_typematic((u8int) first, (u8int) second));
+            return;
+        }
+    } else if (terminal_equal(word, "leds")) {
+        terminal_next_word(&args, word, sizeof(word));
+        if (terminal_parse_dec(word, &first) && first <= 7) {
+            terminal_keyboard_result(keyboard_set_leds((u8int) first));
+            return;
+        }
+    } else if (terminal_equal(word, "repeat")) {
+        terminal_next_word(&args, word, sizeof(word));
+        if (terminal_equal(word, "on") || terminal_equal(word, "off")) {
+            keyboard_set_repeat(terminal_equal(word, "on"));
+            fb_write_string("OK\n");
+            return;
+        }
+    }
+
+    fb_write_string("Usage: kbd rate <0-31> <0-3>   (0 = fastest repeat / shortest delay)\n");
+    fb_write_string("       kbd leds <0-7>          (1 = Scroll, 2 = Num, 4 = Caps)\n");
+    fb_write_string("       kbd repeat on|off\n");
+    fb_write_string("Key repeat is currently ");
+    fb_write_string(keyboard_repeat_enabled() ? "on\n" : "off\n");
+}
+
+// uptime命令：显示开机以来的时间
+void cmd_uptime(char* args) {
+    u32int fraction;
+    u32int seconds = timer_uptime(&fraction);
+
+    (void)args; // 未使用参数
+
+    fb_write_string("Up ");
+    fb_write_dec(seconds);
+    fb_write_string(".");
+    fb_write_string(fraction < 100 ? (fraction < 10 ? "00" : "0") : "");
+    fb_write_dec(fraction);
+    fb_write_string(" s\n");
+}
+
+// sleep命令：睡眠指定的毫秒数
+void cmd_sleep(char* args) {
+    char word[16];
+    u32int ms;
+
+    terminal_next_word(&args, word, sizeof(word));
+    if (!terminal_parse_dec(word, &ms)) {
+        fb_write_string("Usage: sleep <ms>\n");
+        return;
+    }
+    sleep_ms(ms);
+}
+
+// timer命令：显示时钟状态，或切换 tickless 模式
+void cmd_timer(char* args) {
+    char word[16];
+
+    terminal_next_word(&args, word, sizeof(word));
+    if (terminal_equal(word, "tickless")) {
+        terminal_next_word(&args, word, sizeof(word));
+        if (terminal_equal(word, "on") || terminal_equal(word, "off")) {
+            timer_set_tickless(terminal_equal(word, "on"));
+            fb_write_string("OK\n");
+            return;
+        }
+    } else if (terminal_equal(word, "lapic")) {
+        u32int hz;
+
+        terminal_next_word(&args, word, sizeof(word));
+        if (apic_timer_frequency() == 0) {
+            fb_write_string("No local APIC timer\n");
+            return;
+        }
+        if (terminal_equal(word, "off")) {
+            apic_timer_stop();
+            fb_write_string("OK\n");
+            return;
+        }
+        if (terminal_parse_dec(word, &hz) && hz > 0) {
+            if (hz > APIC_TIMER_MAX_HZ || hz > apic_timer_frequency()) {
+                fb_write_string("Rate too high, max ");
+                fb_write_dec(APIC_TIMER_MAX_HZ);
+                fb_write_string(" Hz\n");
+                return;
+            }
+            apic_timer_start(apic_timer_frequency() / hz, 1, 0, 0);
+            fb_write_string("OK\n");
+            return;
+        }
+    } else if (word[0] == '\0') {
+        fb_write_string("Timer:\n");
+        terminal_write_counter("frequency (Hz)", timer_frequency());
+        terminal_write_counter("ticks", (u32int) timer_ticks());
+        terminal_write_counter("interrupts", timer_interrupts());
+        terminal_write_counter("pending kernel timers", ktimer_count());
+        fb_write_string(timer_tickless() ? "  mode: tickless\n" : "  mode: periodic\n");
+        fb_write_string(interrupts_apic() ? "  interrupt controller: local APIC + I/O APIC\n"
+                                          : "  interrupt controller: 8259 PIC\n");
+        if (apic_timer_frequency() != 0) {
+            terminal_write_counter("LAPIC timer (Hz)", apic_timer_frequency());
+            terminal_write_counter("LAPIC timer interrupts", apic_timer_interrupts());
+        }
+        return;
+    }
+    fb_write_string("Usage: timer [tickless on|off]\n");
+    fb_write_string("       timer lapic <hz>|off   (periodic local APIC timer interrupts)\n");
+}
+
+// scroll命令：选择硬件滚动（移动 CRTC 起始地址）或整屏拷贝滚动
+void cmd_scroll(char* args) {
+    char word[16];
+
+    terminal_next_word(&args, word, sizeof(word));
+    if (terminal_equal(word, "hw") || terminal_equal(word, "copy")) {
+        fb_set_hw_scroll(terminal_equal(word, "hw"));
+        fb_write_string("OK\n");
+        return;
+    }
+    if (word[0] != '\0') {
+        fb_write_string("Usage: scroll [hw|copy]\n");
+        return;
+    }
+    fb_write_string(fb_hw_scroll_enabled() ? "Scrolling: hardware (CRTC start address)\n"
+                                           : "Scrolling: copy\n");
+}
@@ -1,32 +1,39 @@
-#ifndef INCLUDE_TERMINAL_H
-#define INCLUDE_TERMINAL_H
-
-#include "types.h"
-
-// 命令结构
-struct command {
-    const char* name;
-    void (*function)(char* args);
-    const char* description;
-};
-
-// 终端初始化
-void terminal_init(void);
-
-// 运行终端主循环
-void terminal_run(void);
-
-// 显示提示符
-void terminal_prompt(void);
-
-// 解析和执行命令
-void terminal_execute(char* input);
-
-// 命令函数声明
-void cmd_echo(char* args);
-void cmd_clear(char* args);
-void cmd_help(char* args);
-void cmd_version(char* args);
-void cmd_shutdown(char* args);
-
+#ifndef INCLUDE_TERMINAL_H
+#define INCLUDE_TERMINAL_H
+
+#include "types.h"
+
+// 命令结构
+struct command {
+    const char* name;
+    void (*function)(char* args);
+    const char* description;
+};
+
+// 终端初始化
+void terminal_init(void);
+
+// 运行终端主循环
+void terminal_run(void);
+
+// 显示提示符
+void terminal_prompt(void);
+
+// 解析和执行命令
+void terminal_execute(char* input);
+
+// 命令函数声明
+void cmd_echo(char* args);
+void cmd_clear(char* args);
+void cmd_help(char* args);
+void cmd_version(char* args);
+void cmd_shutdown(char* args);
+void cmd_stats(char* args);
+void cmd_dmesg(char* args);
+void cmd_kbd(char* args);
+void cmd_uptime(char* args);
+void cmd_sleep(char* args);
+void cmd_timer(char* args);
+void cmd_scroll(char* args);
+
 #endif /* INCLUDE_TERMINAL_H */
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "timer.h"
+#include "io.h"
+#include "pic.h"
+#include "interrupts.h"
+#include "hardware_interrupt_enabler.h"
+#include "wait.h"
+#include "ktimer.h"
+
+/* The I/O ports */
+#define TIMER_CHANNEL0_PORT 0x40
+#define TIMER_COMMAND_PORT  0x43
+
+/* The I/O port commands */
+#define TIMER_ONE_SHOT_CHANNEL0  0x30   // 通道 0，先低后高字节，模式 0（计数到 0 时中断一次）
+#define TIMER_PERIODIC_CHANNEL0  0x34   // 通道 0，先低后高字节，模式 2（周期中断）
+#define TIMER_READ_BACK_CHANNEL0 0xC2   // 回读命令：同时锁存通道 0 的状态和计数
+#define TIMER_STATUS_OUTPUT      0x80   // 状态字节中的 OUT 引脚：模式 0 计数到 0 后变为 1
+#define TIMER_STATUS_NULL_COUNT  0x40   // 新写入的计数还没有装入计数器
+
+#define TIMER_MAX_COUNT 0xFFFF
+
+static volatile u64int timer_tick_count = 0;
+static u32int timer_remainder = 0;        // 不足一个 tick 的 PIT 周期数
+static u32int timer_hz = 0;
+static u32int timer_cycles_per_tick = 0;
+static u32int timer_shot_cycles = 0;      // 当前这次计数的长度（PIT 周期）
+static u8int timer_tickless_mode = 0;
+static u8int timer_stale_irq = 0;         // 切换模式后，下一次中断可能是切换前的计数产生的
+static u64int timer_deadline = TIMER_NO_DEADLINE;
+static u32int timer_irq_count = 0;
+
+// 64 位数除以 32 位数（内核不链接 libgcc，不能直接用 64 位除法）
+static u64int timer_div64(u64int value, u32int divisor, u32int* remainder) {
+    u32int high = (u32int) (value >> 32);
+    u32int low = (u32int) value;
+    u32int quotient_high = high / divisor;
+    u32int quotient_low;
+    u32int rest = high % divisor;
+
+    // rest < divisor，商不会超过 32 位
+    __asm__("divl %4" : "=a" (quotient_low), "=d" (rest) : "0" (low), "1" (rest), "rm" (divisor));
+    if (remainder) {
+        *remainder = rest;
+    }
+    return ((u64int) quotient_high << 32) | quotient_low;
+}
+
+// 把 PIT 走过的周期数累加到 tick 计数
+static void timer_advance(u32int cycles) {
+    timer_remainder += cycles;
+    timer_tick_count += timer_remainder / timer_cycles_per_tick;
+    timer_remainder %= timer_cycles_per_tick;
+}
+
+static void timer_write_count(u8int command, u32int count) {
+    outb(TIMER_COMMAND_PORT, command);
+    outb(TIMER_CHANNEL0_PORT, count & 0xFF);
+    outb(TIMER_CHANNEL0_PORT, (count >> 8) & 0xFF);
+}
+
+// 用同一条回读命令锁存通道 0 的状态和计数，两者一致；返回状态字节
+static u8int timer_read_back(u32int* count) {
+    u8int status;
+
+    outb(TIMER_COMMAND_PORT, TIMER_READ_BACK_CHANNEL0);
+    status = inb(TIMER_CHANNEL0_PORT);
+    *count = inb(TIMER_CHANNEL0_PORT);
+    *count |= (u32int) inb(TIMER_CHANNEL0_PORT) << 8;
+    return status;
+}
+
+// 当前一次性计数已经走过的周期数。
+// 计数到 0 后 *expired 为 1（中断正在等待处理），计数器继续从 0xFFFF 往下减，
+// 超出的周期也计入返回值
+static u32int timer_shot_elapsed(u8int* expired) {
+    u32int count;
+    u8int status = timer_read_back(&count);
+
+    *expired = 0;
+    if (status & TIMER_STATUS_NULL_COUNT) {
+        return 0;   // 刚设置的计数还没开始
+    }
+    if (status & TIMER_STATUS_OUTPUT) {
+        *expired = 1;
+        return timer_shot_cycles + ((0x10000 - count) & 0xFFFF);
+    }
+    return timer_shot_cycles - count;
+}
+
+// 周期模式下当前这个 tick 已经走过的周期数：模式 2 的计数从
+// timer_cycles_per_tick 减到 1 后重新装入
+static u32int timer_period_elapsed(void) {
+    u32int count;
+    u8int status = timer_read_back(&count);
+
+    if ((status & TIMER_STATUS_NULL_COUNT) || count == 0 || count > timer_cycles_per_tick) {
+        return 0;
+    }
+    return timer_cycles_per_tick - count;
+}
+
+// tickless 模式：为最近的截止时间设置下一次一次性计数；需在关中断下调用。
+// sleep_ms 的截止时间和内核定时器的最近到期时间分开保存，取较早的一个，
+// 其中一个到期时不会丢掉另一个
+static void timer_arm(void) {
+    u32int cycles = TIMER_MAX_COUNT;
+    u64int deadline = ktimer_deadline();
+
+    if (timer_deadline < deadline) {
+        deadline = timer_deadline;
+    }
+    if (deadline != TIMER_NO_DEADLINE) {
+        u64int now = timer_tick_count;
+        u64int ticks = deadline > now ? deadline - now : 1;
+
+        if (ticks * timer_cycles_per_tick < TIMER_MAX_COUNT + (u64int) timer_remainder) {
+            cycles = (u32int) ticks * timer_cycles_per_tick - timer_remainder;
+        }
+    }
+    if (cycles == 0) {
+        cycles = 1;
+    }
+    timer_shot_cycles = cycles;
+    timer_write_count(TIMER_ONE_SHOT_CHANNEL0, cycles);
+}
+
+static void timer_handle_interrupt(struct trap_frame* frame, void* context) {
+    (void)frame;
+    (void)context;
+
+    timer_irq_count++;
+    if (timer_tickless_mode) {
+        // 按实际走过的周期累加，包括计数到 0 之后中断等待处理的时间
+        u8int expired;
+        timer_advance(timer_shot_elapsed(&expired));
+        // 一次性计数没有到 0：这是切换前周期计数回绕产生的中断，那个 tick 还没有计入
+        if (!expired && timer_stale_irq) {
+            timer_advance(timer_cycles_per_tick);
+        }
+    } else if (!timer_stale_irq) {
+        timer_advance(timer_cycles_per_tick);
+    }
+    timer_stale_irq = 0;
+
+    if (timer_tick_count >= timer_deadline) {
+        timer_deadline = TIMER_NO_DEADLINE;
+    }
+    // 先让内核定时器检查到期（到期后清除它的最近到期时间），再设置下一次计数
+    ktimer_interrupt(timer_tick_count);
+    if (timer_tickless_mode) {
+        timer_arm();
+    }
+}
+
+void timer_init(u32int hz) {
+    if (hz == 0) {
+        hz = TIMER_DEFAULT_HZ;
+    } else if (hz < TIMER_MIN_HZ) {
+        hz = TIMER_MIN_HZ;
+    } else if (hz > TIMER_BASE_HZ) {
+        hz = TIMER_BASE_HZ;
+    }
+
+    // PIT 只能按整数分频：取最接近的除数，记录实际得到的频率
+    timer_cycles_per_tick = (TIMER_BASE_HZ + hz / 2) / hz;
+    timer_hz = (TIMER_BASE_HZ + timer_cycles_per_tick / 2) / timer_cycles_per_tick;
+
+    timer_write_count(TIMER_PERIODIC_CHANNEL0, timer_cycles_per_tick);
+    irq_register(PIC_1_OFFSET + TIMER_IRQ, timer_handle_interrupt, 0);
+    irq_unmask(TIMER_IRQ);
+}
+
+u32int timer_frequency(void) {
+    return timer_hz;
+}
+
+u64int timer_ticks(void) {
+    u32int flags = save_and_disable_hardware_interrupts();
+    u64int ticks = timer_tick_count;
+
+    if (timer_tickless_mode) {
+        u8int expired;
+        ticks += (timer_remainder + timer_shot_elapsed(&expired)) / timer_cycles_per_tick;
+    }
+    restore_hardware_interrupts(flags);
+    return ticks;
+}
+
+// 开机以来走过的 PIT 周期数
+static u64int timer_cycles(void) {
+    u32int flags = save_and_disable_hardware_interrupts();
+    u64int cycles = timer_tick_count * timer_cycles_per_tick + timer_remainder;
+
+    if (timer_tickless_mode) {
+        u8int expired;
+        cycles += timer_shot_elapsed(&expired);
+    }
+    restore_hardware_interrupts(flags);
+    return cycles;
+}
+
+u64int timer_uptime_ms(void) {
+    // 按 PIT 周期换算，不受分频取整的影响
+    return timer_div64(timer_cycles() * 1000, TIMER_BASE_HZ, 0);
+}
+
+u32int timer_uptime(u32int* milliseconds) {
+    u32int rest;
+    u32int seconds = (u32int) timer_div64(timer_uptime_ms(), 1000, &rest);
+
+    if (milliseconds) {
+        *milliseconds = rest;
+    }
+    return seconds;
+}
+
+u32int timer_ms_to_ticks(u32int ms) {
+    u32int rest;
+    u64int cycles = timer_div64((u64int) ms * TIMER_BASE_HZ, 1000, &rest);
+    u64int ticks;
+
+    // 按实际的 tick 长度（PIT 周期）向上取整
+    if (rest != 0) {
+        cycles++;
+    }
+    ticks = timer_div64(cycles + timer_cycles_per_tick - 1, timer_cycles_per_tick, 0);
+    if (ticks == 0) {
+        return 1;
+    }
+    return ticks > 0xFFFFFFFF ? 0xFFFFFFFF : (u32int) ticks;
+}
+
+void timer_reprogram(void) {
+    u32int flags = save_and_disable_hardware_interrupts();
+
+    // 把正在进行的一次性计数已经走过的时间记入时钟后按新的截止时间重新设置。
+    // 计数已经到 0 时中断正在等待，由中断处理程序设置
+    if (timer_tickless_mode) {
+        u8int expired;
+        u32int elapsed = timer_shot_elapsed(&expired);
+        if (!expired) {
+            timer_advance(elapsed);
+            timer_arm();
+        }
+    }
+    restore_hardware_interrupts(flags);
+}
+
+void timer_set_deadline(u64int deadline) {
+    u32int flags = save_and_disable_hardware_interrupts();
+
+    if (deadline < timer_deadline) {
+        timer_deadline = deadline;
+        timer_reprogram();
+    }
+    restore_hardware_interrupts(flags);
+}
+
+// sleep_ms 的等待条件：tick 数到达截止时间
+static u32int timer_reached(void* context) {
+    return timer_tick_count >= *(u64int*) context;
+}
+
+void sleep_ms(u32int ms) {
+    u64int deadline = timer_ticks() + timer_ms_to_ticks(ms);
+
+    timer_set_deadline(deadline);
+    wait_until(timer_reached, &deadline);
+}
+
+void timer_set_tickless(u8int enable) {
+    u32int flags = save_and_disable_hardware_interrupts();
+
+    // 两个方向都先把当前计数已经走过的周期记入时钟，再换模式重新计数
+    if (enable && !timer_tickless_mode) {
+        timer_advance(timer_period_elapsed());
+        timer_stale_irq = 1;
+        timer_tickless_mode = 1;
+        timer_arm();
+    } else if (!enable && timer_tickless_mode) {
+        u8int expired;
+        timer_advance(timer_shot_elapsed(&expired));
+        // 计数已到 0：等待处理的中断在周期模式下到达，不能再按一个 tick 累加
+        timer_stale_irq = expired;
+        timer_tickless_mode = 0;
+        timer_write_count(TIMER_PERIODIC_CHANNEL0, timer_cycles_per_tick);
+    }
+    restore_hardware_interrupts(flags);
+}
+
+u8int timer_tickless(void) {
+    return timer_tickless_mode;
+}
+
+u32int timer_interrupts(void) {
+    return timer_irq_count;
+}
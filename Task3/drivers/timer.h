@@ -0,0 +1,49 @@
+#ifndef INCLUDE_TIMER_H
+#define INCLUDE_TIMER_H
+
+#include "types.h"
+
+#define TIMER_IRQ          0        // 8254 PIT 通道 0 接在 IRQ0
+#define TIMER_BASE_HZ      1193182  // PIT 输入时钟频率
+#define TIMER_DEFAULT_HZ   1000     // 默认 tick 频率
+#define TIMER_MIN_HZ       19       // 16 位计数器能达到的最低频率
+#define TIMER_NO_DEADLINE  0xFFFFFFFFFFFFFFFFULL
+
+// 初始化 PIT：每秒约 hz 个 tick（超出 TIMER_MIN_HZ..TIMER_BASE_HZ 时取边界值），
+// 周期模式，注册并打开 IRQ0
+void timer_init(u32int hz);
+
+// 实际的 tick 频率（取整）。PIT 只能整数分频，例如 1000 Hz 实际为 1193182 / 1193 Hz；
+// 时间换算都按 PIT 周期计算，不使用这个近似值
+u32int timer_frequency(void);
+
+// 开机以来的单调 tick 数（64 位，不会回绕）；tickless 模式下包含当前一次计数已经走过的部分
+u64int timer_ticks(void);
+
+// 开机以来的毫秒数
+u64int timer_uptime_ms(void);
+
+// 开机以来的整秒数，milliseconds 不为 0 时返回不足一秒的毫秒数
+u32int timer_uptime(u32int* milliseconds);
+
+// 毫秒数换算成 tick 数（向上取整，至少为 1）
+u32int timer_ms_to_ticks(u32int ms);
+
+// 请求在 tick 数到达 deadline 时产生一次时钟中断；多个请求取最早的一个
+void timer_set_deadline(u64int deadline);
+
+// 内核定时器的最近到期时间（ktimer_deadline）变化后调用，tickless 模式下重新设置计数
+void timer_reprogram(void);
+
+// 睡眠至少 ms 毫秒（期间 CPU 处于 hlt，其他中断照常处理）
+void sleep_ms(u32int ms);
+
+// tickless 模式：不再按固定频率中断，而是为最近的截止时间设置一次性计数。
+// 没有截止时间时计数设为 PIT 的最大值（约 55 毫秒）以维持时钟
+void timer_set_tickless(u8int enable);
+u8int timer_tickless(void);
+
+// 时钟中断次数
+u32int timer_interrupts(void);
+
+#endif /* INCLUDE_TIMER_H */
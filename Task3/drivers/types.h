@@ -1,29 +1,30 @@
-#ifndef INCLUDE_TYPES_H
-#define INCLUDE_TYPES_H
-
-typedef unsigned int u32int;
-typedef int s32int;
-typedef unsigned short u16int;
-typedef short s16int;
-typedef unsigned char u8int;
-typedef char s8int;
-
-/* Frame buffer colors */
-#define BLACK    0
-#define BLUE    1
-#define GREEN    2
-#define CYAN    3
-#define RED    4
-#define MAGENTA    5
-#define BROWN    6
-#define LIGHT_GREY 7
-#define DARK_GREY 8
-#define LIGHT_BLUE 9
-#define LIGHT_GREEN 10
-#define LIGHT_CYAN 11
-#define LIGHT_RED 12
-#define LIGHT_MAGENTA 13
-#define YELLOW 14
-#define WHITE 15
-
+#ifndef INCLUDE_TYPES_H
+#define INCLUDE_TYPES_H
+
+typedef unsigned long long u64int;
+typedef unsigned int u32int;
+typedef int s32int;
+typedef unsigned short u16int;
+typedef short s16int;
+typedef unsigned char u8int;
+typedef char s8int;
+
+/* Frame buffer colors */
+#define BLACK    0
+#define BLUE    1
+#define GREEN    2
+#define CYAN    3
+#define RED    4
+#define MAGENTA    5
+#define BROWN    6
+#define LIGHT_GREY 7
+#define DARK_GREY 8
+#define LIGHT_BLUE 9
+#define LIGHT_GREEN 10
+#define LIGHT_CYAN 11
+#define LIGHT_RED 12
+#define LIGHT_MAGENTA 13
+#define YELLOW 14
+#define WHITE 15
+
 #endif
\ No newline at end of file
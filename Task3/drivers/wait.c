@@ -0,0 +1,39 @@
+#include "wait.h"
+#include "hardware_interrupt_enabler.h"
+
+void wait_until(wait_condition condition, void* context) {
+    u32int flags = save_and_disable_hardware_interrupts();
+
+    while (!condition(context)) {
+        if (flags & EFLAGS_IF) {
+            // sti 之后的一条指令不响应中断，sti; hlt 之间不会丢失唤醒；
+            // 醒来后关中断再检查条件
+            __asm__ __volatile__("sti; hlt; cli" : : : "memory");
+        }
+    }
+    restore_hardware_interrupts(flags);
+}
+
+void wait_event_signal(struct wait_event* event) {
+    event->count++;
+}
+
+// 事件计数是否已经不同于等待方上次看到的值；是的话在关中断下记下新计数
+static u32int wait_event_changed(void* context) {
+    void** args = (void**) context;
+    struct wait_event* event = (struct wait_event*) args[0];
+    u32int* seen = (u32int*) args[1];
+    u32int count = event->count;
+
+    if (count == *seen) {
+        return 0;
+    }
+    *seen = count;
+    return 1;
+}
+
+void wait_event_wait(struct wait_event* event, u32int* seen) {
+    void* args[2] = {event, seen};
+
+    wait_until(wait_event_changed, args);
+}
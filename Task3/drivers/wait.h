@@ -0,0 +1,27 @@
+#ifndef INCLUDE_WAIT_H
+#define INCLUDE_WAIT_H
+
+#include "types.h"
+
+// 等待条件：返回非 0 表示条件已满足。调用时中断是关闭的，
+// 条件函数可以安全地读取中断处理程序修改的状态（或轮询硬件）
+typedef u32int (*wait_condition)(void* context);
+
+// 睡眠直到条件满足。每次检查都在关中断下进行，条件不满足时用 sti; hlt
+// 原子地开中断并睡眠，检查之后到达的中断一定会唤醒 CPU，不会丢失唤醒。
+// 调用时中断已关闭的话不会开中断，只是反复检查条件
+void wait_until(wait_condition condition, void* context);
+
+// 事件：中断处理程序调用 wait_event_signal，等待方记住上次看到的计数，
+// 计数变化即说明有新事件
+struct wait_event {
+    volatile u32int count;
+};
+
+// 通知事件（可以在中断处理程序中调用）
+void wait_event_signal(struct wait_event* event);
+
+// 睡眠直到事件在 *seen 之后被通知过，返回时把 *seen 更新为最新计数
+void wait_event_wait(struct wait_event* event, u32int* seen);
+
+#endif /* INCLUDE_WAIT_H */
@@ -1,28 +1,46 @@
-#include "../drivers/frame_buffer.h"
-#include "../drivers/hardware_interrupt_enabler.h"
-#include "../drivers/interrupts.h"
-#include "../drivers/input_buffer.h"
-#include "../drivers/terminal.h"
-
-int kmain() 
-{
-    // 清屏并显示启动消息
-    fb_clear();
-    fb_write_string("=== MyOS Booting ===\n");
-    fb_write_string("Initializing system components...\n");
-    
-    // 安装IDT并启用中断
-    interrupts_install_idt();
-    enable_hardware_interrupts();
-    
-    fb_write_string("✓ Interrupt system ready\n");
-    fb_write_string("✓ Input buffer cleinitialized\n");
-    fb_write_string("✓ Terminal system ready\n");
-    
-    // 初始化并运行终端
-    terminal_init();
-    terminal_run();
-
-    // 正常情况下不会到达这里
-    return 0;
+#include "../drivers/frame_buffer.h"
+#include "../drivers/hardware_interrupt_enabler.h"
+#include "../drivers/interrupts.h"
+#include "../drivers/input_buffer.h"
+#include "../drivers/terminal.h"
+#include "../drivers/serial.h"
+#include "../drivers/klog.h"
+#include "../drivers/keyboard.h"
+#include "../drivers/timer.h"
+#include "../drivers/apic.h"
+
+int kmain() 
+{
+    // 先初始化串口，之后的控制台输出都会同步到 COM1
+    serial_init();
+
+    // 清屏并显示启动消息
+    fb_clear();
+    fb_write_string("=== MyOS Booting ===\n");
+    klog(KLOG_INFO, "MyOS booting");
+    klog(KLOG_INFO, "COM1 serial console ready");
+    
+    // 安装IDT并启用中断
+    interrupts_install_idt();
+    keyboard_init();
+    timer_init(TIMER_DEFAULT_HZ);
+    enable_hardware_interrupts();
+
+    // 空闲时不再按固定频率唤醒 CPU，只在有截止时间时产生时钟中断
+    timer_set_tickless(1);
+
+    // 本地 APIC 定时器的频率与总线有关，用 PIT 测量
+    apic_timer_calibrate();
+    
+    klog(KLOG_INFO, "Interrupt system ready");
+    klog(KLOG_INFO, "PIT timer ready (tickless idle)");
+    klog(KLOG_INFO, "Input buffer initialized");
+    klog(KLOG_INFO, "Terminal system ready");
+    
+    // 初始化并运行终端
+    terminal_init();
+    terminal_run();
+
+    // 正常情况下不会到达这里
+    return 0;
 }
\ No newline at end of file
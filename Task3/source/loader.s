@@ -1,33 +1,33 @@
-global loader
-extern kmain
-
-; Multiboot header constants
-MODULEALIGN equ  1<<0
-MEMINFO     equ  1<<1
-FLAGS       equ  MODULEALIGN | MEMINFO
-MAGIC       equ  0x1BADB002
-CHECKSUM    equ -(MAGIC + FLAGS)
-
-section .text
-align 4
-MultiBootHeader:
-    dd MAGIC
-    dd FLAGS
-    dd CHECKSUM
-
-loader:
-    mov esp, kernel_stack + KERNEL_STACK_SIZE
-    push eax
-    push ebx
-    call kmain
-    
-hang:
-    hlt
-    jmp hang
-
-KERNEL_STACK_SIZE equ 4096
-
-section .bss
-align 4
-kernel_stack:
+global loader
+extern kmain
+
+; Multiboot header constants
+MODULEALIGN equ  1<<0
+MEMINFO     equ  1<<1
+FLAGS       equ  MODULEALIGN | MEMINFO
+MAGIC       equ  0x1BADB002
+CHECKSUM    equ -(MAGIC + FLAGS)
+
+section .text
+align 4
+MultiBootHeader:
+    dd MAGIC
+    dd FLAGS
+    dd CHECKSUM
+
+loader:
+    mov esp, kernel_stack + KERNEL_STACK_SIZE
+    push eax
+    push ebx
+    call kmain
+    
+hang:
+    hlt
+    jmp hang
+
+KERNEL_STACK_SIZE equ 4096
+
+section .bss
+align 4
+kernel_stack:
     resb KERNEL_STACK_SIZE
\ No newline at end of file